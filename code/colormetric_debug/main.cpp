@@ -4,6 +4,9 @@
 #include "WiFi.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "img_converters.h"
+#include "../esp32/main/sensor/roi_stats.h"
+#include "../esp32/main/sensor/roi_table.h"
 
 // ==============================
 // Camera pin map (XIAO ESP32-S3 Sense)
@@ -47,6 +50,55 @@ static bool rgb565_is_bgr = (RGB565_IS_BGR != 0);
 // stabilize color (milliseconds). Set to 0 to keep auto controls on.
 #define AUTO_FREEZE_AFTER_MS 1500
 
+// /stream serves MJPEG from a second server on this port, so /color.json and
+// the rest stay responsive while a viewer is connected. Quality (1-100) and
+// the frame-rate cap can be overridden per request with ?q= and ?fps=.
+#define STREAM_PORT          81
+#define STREAM_JPEG_QUALITY  60
+#define STREAM_MAX_FPS       15
+
+// Frame buffers: the capture task fills one while the last published frame
+// is read from another. The rest keep frames coming while whole-frame
+// downloads (/frame.raw, /frame.ppm) hold one each for the length of the
+// transfer, so only MAX_DOWNLOADS of those run at once.
+#define CAMERA_FB_COUNT      3
+#define MAX_DOWNLOADS        (CAMERA_FB_COUNT - 2)
+
+// /frame.raw sends the frame buffer in pieces this big, straight from PSRAM
+#define RAW_CHUNK_BYTES      32768
+
+// How long a request waits for a frame before giving up
+#define FRAME_WAIT_MS        1000
+
+// /frame.ppm converts and sends this many rows at a time
+#define PPM_ROWS_PER_CHUNK   8
+
+// Long transfers (/frame.ppm, /frame.raw, /stream) run on a pool of worker
+// tasks so the httpd task stays free for /color.json and /settings. Each
+// worker serves one client at a time; a request that finds no free worker,
+// or a stream over MAX_STREAMS or download over MAX_DOWNLOADS, gets 503.
+// Streams never take the last worker.
+#define ASYNC_WORKERS        3
+#define MAX_STREAMS          2
+#define ASYNC_WORKER_STACK   6144
+
+// /preview box-filters the frame down by ?scale=2..8 (default below) for
+// aiming and focusing; bytes sent and JPEG work drop with the square of it
+#define PREVIEW_DEFAULT_SCALE 4
+#define PREVIEW_MAX_SCALE     8
+
+// 1 = at boot, time the per-pixel and the table-driven RGB565 -> RGB888 row
+// conversion on the first frame and print rows per millisecond
+#define CONVERT_BENCH        0
+
+// /ws pushes a JSON record per frame to each WebSocket client: center window
+// mean, standard deviation and color name, and every ROI's mean and standard
+// deviation. ?hz= on the handshake, or a "hz=N" text message later, caps the
+// rate for that client. Needs CONFIG_HTTPD_WS_SUPPORT (on in the Arduino core).
+#define WS_MAX_CLIENTS       4
+#define WS_DEFAULT_HZ        10
+#define WS_MAX_HZ            30
+
 // ==============================
 // Color naming helpers
 // ==============================
@@ -116,6 +168,110 @@ static inline void rgb565_to_rgb888(uint16_t pix, uint8_t &r, uint8_t &g, uint8_
   rgb565_to_rgb888_format(pix, r, g, b, fmt);
 }
 
+// ==============================
+// Whole-row RGB565 -> RGB888
+// ==============================
+// 5- and 6-bit codes expanded to 8 bits, with the same rounding as
+// rgb565_to_rgb888_format. Byte order and R/B order are template
+// parameters, so the per-pixel loop is just loads and table lookups.
+static uint8_t expand5[32], expand6[64];
+
+static void init_expand_tables() {
+  for (int v = 0; v < 32; ++v) expand5[v] = uint8_t(v * 255 / 31);
+  for (int v = 0; v < 64; ++v) expand6[v] = uint8_t(v * 255 / 63);
+}
+
+template <bool BIG_END, bool BGR>
+static void rgb565_row_to_rgb888(const uint8_t *src, uint8_t *dst, int n) {
+  const int hi_i = BIG_END ? 0 : 1, lo_i = BIG_END ? 1 : 0;
+  const int r_o = BGR ? 2 : 0, b_o = BGR ? 0 : 2;
+  for (int x = 0; x < n; ++x, src += 2, dst += 3) {
+    const uint8_t hi = src[hi_i], lo = src[lo_i];
+    dst[r_o] = expand5[hi >> 3];
+    dst[1]   = expand6[((hi & 0x07) << 3) | (lo >> 5)];
+    dst[b_o] = expand5[lo & 0x1F];
+  }
+}
+
+typedef void (*RowConverter)(const uint8_t *src, uint8_t *dst, int n);
+
+// Indexed by PixelFormat
+static const RowConverter ROW_CONVERTERS[FMT_COUNT] = {
+  rgb565_row_to_rgb888<false, false>,  // FMT_RGB565_LE
+  rgb565_row_to_rgb888<false, true>,   // FMT_BGR565_LE
+  rgb565_row_to_rgb888<true, false>,   // FMT_RGB565_BE
+  rgb565_row_to_rgb888<true, true>,    // FMT_BGR565_BE
+};
+
+// ==============================
+// Box filter for /preview
+// ==============================
+// Each NxN block becomes one pixel. The row pass adds N pixels at a time
+// into per-column sums, the two 5-bit fields in one 32-bit word 16 bits
+// apart (no carry between them up to 8x8 blocks) and the 6-bit field in a
+// second. After N rows the sums are scaled to 8 bits with a multiply.
+template <bool BIG_END>
+static void box_row_accumulate(const uint8_t *src, int out_w, int n, uint32_t *acc_hl, uint32_t *acc_g) {
+  const int hi_i = BIG_END ? 0 : 1, lo_i = BIG_END ? 1 : 0;
+  for (int x = 0; x < out_w; ++x) {
+    uint32_t hl = 0, g = 0;
+    for (int k = 0; k < n; ++k, src += 2) {
+      const uint32_t v = (uint32_t(src[hi_i]) << 8) | src[lo_i];
+      hl += ((v & 0xF800) << 5) | (v & 0x001F);
+      g  += v & 0x07E0;
+    }
+    acc_hl[x] += hl;
+    acc_g[x]  += g >> 5;
+  }
+}
+
+typedef void (*BoxAccumulator)(const uint8_t *src, int out_w, int n, uint32_t *acc_hl, uint32_t *acc_g);
+
+// Indexed by PixelFormat; R/B order only matters when the row is finished
+static const BoxAccumulator BOX_ACCUMULATORS[FMT_COUNT] = {
+  box_row_accumulate<false>,  // FMT_RGB565_LE
+  box_row_accumulate<false>,  // FMT_BGR565_LE
+  box_row_accumulate<true>,   // FMT_RGB565_BE
+  box_row_accumulate<true>,   // FMT_BGR565_BE
+};
+
+// Q16 factor taking a sum of `count` codes of max value `max_code` to 0..255
+static inline uint32_t box_scale_q16(uint32_t max_code, uint32_t count) {
+  const uint32_t full = max_code * count;
+  return (255u * 65536u + full / 2) / full;
+}
+
+static inline uint8_t box_to_8bit(uint32_t sum, uint32_t q16) {
+  const uint32_t v = (sum * q16 + 32768) >> 16;
+  return v > 255 ? 255 : uint8_t(v);
+}
+
+// Column sums -> RGB888; hi_o is where the top 5-bit field goes (0 or 2)
+static void box_row_finish(const uint32_t *acc_hl, const uint32_t *acc_g, int out_w,
+                           uint32_t q5, uint32_t q6, int hi_o, uint8_t *dst) {
+  const int lo_o = 2 - hi_o;
+  for (int x = 0; x < out_w; ++x, dst += 3) {
+    dst[hi_o] = box_to_8bit(acc_hl[x] >> 16, q5);
+    dst[1]    = box_to_8bit(acc_g[x], q6);
+    dst[lo_o] = box_to_8bit(acc_hl[x] & 0xFFFF, q5);
+  }
+}
+
+// Layout flags for the shared ROI stats kernel
+static inline uint32_t roi_flags(PixelFormat fmt) {
+  return ((fmt == FMT_BGR565_LE || fmt == FMT_BGR565_BE) ? ROI_STATS_BGR : 0) |
+         ((fmt == FMT_RGB565_BE || fmt == FMT_BGR565_BE) ? ROI_STATS_BIG_END : 0);
+}
+
+// Stats of the (2*R+1)x(2*R+1) window around the frame center
+static bool center_stats(camera_fb_t *fb, PixelFormat fmt, bool hist, roi_stats_t &st) {
+  const int R = AVG_RADIUS;
+  size_t stride_bytes = (fb->height > 0) ? fb->len / fb->height : size_t(fb->width) * 2;
+  const int w = int(fb->width), h = int(fb->height);
+  roi_rect_t rect = { w / 2 - R, h / 2 - R, 2 * R + 1, 2 * R + 1 };
+  return roi_stats(fb->buf, w, h, stride_bytes, rect, roi_flags(fmt), hist, &st);
+}
+
 // Return nearest color name by squared distance in RGB space
 const char* nearest_color_name(uint8_t r, uint8_t g, uint8_t b) {
   uint32_t best = 0xFFFFFFFF;
@@ -213,6 +369,37 @@ PixelFormat detect_pixel_format(camera_fb_t *fb) {
   return best_format;
 }
 
+#if CONVERT_BENCH
+// Rows per millisecond of both conversions over the same frame
+static void convert_bench(camera_fb_t *fb, PixelFormat fmt) {
+  const int w = fb->width, h = fb->height;
+  const size_t stride_bytes = (h > 0) ? fb->len / h : size_t(w) * 2;
+  uint8_t *row = (uint8_t*)malloc(size_t(w) * 3);
+  if (!row) return;
+
+  uint32_t t0 = micros();
+  for (int y = 0; y < h; ++y) {
+    const uint8_t *src = fb->buf + size_t(y) * stride_bytes;
+    for (int x = 0; x < w; ++x) {
+      uint16_t pix = uint16_t(src[x * 2]) | (uint16_t(src[x * 2 + 1]) << 8);
+      rgb565_to_rgb888_format(pix, row[x * 3], row[x * 3 + 1], row[x * 3 + 2], fmt);
+    }
+  }
+  const uint32_t per_pixel_us = micros() - t0;
+
+  t0 = micros();
+  for (int y = 0; y < h; ++y) {
+    ROW_CONVERTERS[fmt](fb->buf + size_t(y) * stride_bytes, row, w);
+  }
+  const uint32_t table_us = micros() - t0;
+
+  free(row);
+  Serial.printf("Convert %dx%d: per-pixel %.1f rows/ms, table %.1f rows/ms\n", w, h,
+                per_pixel_us ? h * 1000.0f / per_pixel_us : 0.0f,
+                table_us ? h * 1000.0f / table_us : 0.0f);
+}
+#endif
+
 void print_memory_info(const char* tag) {
   size_t psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
   size_t psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
@@ -235,11 +422,122 @@ static const char *TAG = "camserver";
 
 // Simple HTTP server handle
 static httpd_handle_t server = NULL;
+static httpd_handle_t stream_server = NULL;
+
+// ==============================
+// Latest frame, shared
+// ==============================
+// One task owns the camera. Each frame it gets is measured once and
+// published; loop() and the HTTP handlers take a reference to the latest
+// one instead of capturing their own, and its buffer goes back to the
+// driver when the last reference is dropped.
+struct SharedFrame {
+  camera_fb_t *fb;
+  uint32_t refs;
+  uint32_t seq;
+  bool stats_valid;             // RGB565 frame, stats below are set
+  roi_stats_t center;           // AVG_RADIUS window, with histograms
+  roi_stats_t rois[ROI_COUNT];  // sensor ROI table
+};
+
+// Every slot in use holds one of the driver's buffers, so there's always a
+// free one for the buffer just captured
+static SharedFrame frame_slots[CAMERA_FB_COUNT];
+static SharedFrame *latest_frame = NULL;
+static portMUX_TYPE frame_mux = portMUX_INITIALIZER_UNLOCKED;
 
 // forward declarations
 static esp_err_t frame_handler(httpd_req_t *req);
+static esp_err_t stream_handler(httpd_req_t *req);
 static esp_err_t index_handler(httpd_req_t *req);
 static void register_uri_handlers();
+static bool async_start();
+static bool ws_start();
+
+static SharedFrame *frame_acquire() {
+  portENTER_CRITICAL(&frame_mux);
+  SharedFrame *f = latest_frame;
+  if (f) f->refs++;
+  portEXIT_CRITICAL(&frame_mux);
+  return f;
+}
+
+static void frame_release(SharedFrame *f) {
+  if (!f) return;
+  portENTER_CRITICAL(&frame_mux);
+  camera_fb_t *done = (--f->refs == 0) ? f->fb : NULL;
+  portEXIT_CRITICAL(&frame_mux);
+  if (done) esp_camera_fb_return(done);
+}
+
+// The latest frame if it's newer than seq `after` (0 = any), waiting up to
+// timeout_ms for one. NULL on timeout.
+static SharedFrame *frame_acquire_newer(uint32_t after, uint32_t timeout_ms) {
+  const uint32_t t0 = millis();
+  for (;;) {
+    SharedFrame *f = frame_acquire();
+    if (f && f->seq != after) return f;
+    frame_release(f);
+    if (millis() - t0 >= timeout_ms) return NULL;
+    delay(5);
+  }
+}
+
+// Center window and ROI table, once per frame for every reader
+static void measure_frame(SharedFrame *f) {
+  // Too big for the task's stack
+  static roi_multi_t rois;
+  camera_fb_t *fb = f->fb;
+  f->stats_valid = (fb->format == PIXFORMAT_RGB565);
+  if (!f->stats_valid) return;
+
+  center_stats(fb, detected_format, true, f->center);
+
+  size_t stride_bytes = (fb->height > 0) ? fb->len / fb->height : size_t(fb->width) * 2;
+  const int w = int(fb->width), h = int(fb->height);
+  roi_multi_begin(&rois, w, h, float(w) / 320.0f, roi_flags(detected_format));
+  for (int y = rois.first_row; y <= rois.last_row; ++y) {
+    roi_multi_add_row(&rois, y, fb->buf + size_t(y) * stride_bytes);
+  }
+  for (int i = 0; i < ROI_COUNT; ++i) {
+    roi_stats_end(&rois.stats[i], false, &f->rois[i]);
+  }
+}
+
+static void capture_task(void *arg) {
+  (void)arg;
+  uint32_t seq = 0;
+  for (;;) {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+      delay(50);
+      continue;
+    }
+
+    SharedFrame *slot = NULL;
+    portENTER_CRITICAL(&frame_mux);
+    for (int i = 0; i < CAMERA_FB_COUNT && !slot; ++i) {
+      if (frame_slots[i].refs == 0) slot = &frame_slots[i];
+    }
+    portEXIT_CRITICAL(&frame_mux);
+    if (!slot) {
+      esp_camera_fb_return(fb);
+      continue;
+    }
+
+    // Not reachable by readers until it's published
+    slot->fb = fb;
+    slot->seq = ++seq;
+    measure_frame(slot);
+    slot->refs = 1;  // the publication's own reference
+
+    portENTER_CRITICAL(&frame_mux);
+    SharedFrame *old = latest_frame;
+    latest_frame = slot;
+    portEXIT_CRITICAL(&frame_mux);
+    frame_release(old);
+  }
+}
 
 void setup() {
   Serial.begin(115200);
@@ -272,7 +570,7 @@ void setup() {
   config.pixel_format = PIXFORMAT_RGB565;
   config.frame_size   = FRAMESIZE_VGA;      // 640x480 for clearer images
   config.xclk_freq_hz = 20000000;           // try 16000000 if flaky
-  config.fb_count     = 1;
+  config.fb_count     = CAMERA_FB_COUNT;
   config.jpeg_quality = 10;                 // Lower = better quality (0-63)
   config.grab_mode    = CAMERA_GRAB_LATEST; // Get latest frame for smoother capture
 
@@ -320,9 +618,13 @@ void setup() {
   
   // Auto-detect pixel format with first frame
   Serial.println("Auto-detecting pixel format...");
+  init_expand_tables();
   camera_fb_t *test_fb = esp_camera_fb_get();
   if (test_fb) {
     detected_format = detect_pixel_format(test_fb);
+#if CONVERT_BENCH
+    convert_bench(test_fb, detected_format);
+#endif
     esp_camera_fb_return(test_fb);
   } else {
     Serial.println("Failed to get test frame for format detection");
@@ -330,6 +632,8 @@ void setup() {
   
   boot_ms = millis();
 
+  xTaskCreate(capture_task, "capture", 4096, NULL, 4, NULL);
+
   // Start WiFi AP
   WiFi.mode(WIFI_AP);
   bool apok = WiFi.softAP(AP_SSID, AP_PASS);
@@ -339,16 +643,38 @@ void setup() {
     Serial.println("Failed to start AP");
   }
 
-  // Start HTTP server
+  if (!async_start()) {
+    Serial.println("Failed to start async HTTP workers");
+  }
+
+  // Start HTTP server. Dropped clients are purged when sockets run out
+  // rather than holding one until their worker times out.
   httpd_config_t config_http = HTTPD_DEFAULT_CONFIG();
   config_http.server_port = 80;
-  if (httpd_start(&server, &config_http) == ESP_OK) {
-    register_uri_handlers();
-    ESP_LOGI(TAG, "HTTP server started");
-  } else {
+  config_http.lru_purge_enable = true;
+  config_http.max_uri_handlers = 12;
+  if (httpd_start(&server, &config_http) != ESP_OK) {
     Serial.println("Failed to start HTTP server");
     server = NULL;
   }
+
+  // Streams stay on their own port; the sockets beyond MAX_STREAMS are
+  // for turning extra viewers away with 503
+  httpd_config_t config_stream = HTTPD_DEFAULT_CONFIG();
+  config_stream.server_port = STREAM_PORT;
+  config_stream.ctrl_port = config_http.ctrl_port + 1;
+  config_stream.max_open_sockets = MAX_STREAMS + 1;
+  config_stream.lru_purge_enable = true;
+  if (httpd_start(&stream_server, &config_stream) != ESP_OK) {
+    Serial.println("Failed to start stream server");
+    stream_server = NULL;
+  }
+
+  register_uri_handlers();
+  if (!ws_start()) {
+    Serial.println("Failed to start WebSocket telemetry");
+  }
+  ESP_LOGI(TAG, "HTTP server started, stream on port %d", STREAM_PORT);
 }
 
 void maybe_freeze_auto() {
@@ -369,46 +695,30 @@ void maybe_freeze_auto() {
 void loop() {
   maybe_freeze_auto();
 
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb) {
-    Serial.println("Failed to get frame buffer");
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) {
+    Serial.println("No frame from the capture task");
     delay(200);
     return;
   }
 
-  if (fb->format != PIXFORMAT_RGB565) {
+  if (!f->stats_valid) {
     Serial.println("Unexpected format! Need RGB565.");
-    esp_camera_fb_return(fb);
+    frame_release(f);
     delay(500);
     return;
   }
 
-  const uint16_t w = fb->width;
-  const uint16_t h = fb->height;
-  const uint16_t cx = w / 2;
-  const uint16_t cy = h / 2;
-  const uint16_t* buf16 = reinterpret_cast<const uint16_t*>(fb->buf);
+  const uint16_t w = f->fb->width;
+  const uint16_t h = f->fb->height;
 
   // Average a window around the center to stabilize reading
   const int R = AVG_RADIUS;
-  uint32_t sumR = 0, sumG = 0, sumB = 0;
-  uint16_t count = 0;
-
-  for (int dy = -R; dy <= R; ++dy) {
-    int y = int(cy) + dy; if (y < 0 || y >= h) continue;
-    uint32_t row = uint32_t(y) * w;
-    for (int dx = -R; dx <= R; ++dx) {
-      int x = int(cx) + dx; if (x < 0 || x >= w) continue;
-  uint16_t pix565 = buf16[row + x];
-  uint8_t r, g, b;
-  rgb565_to_rgb888_format(pix565, r, g, b, detected_format);
-      sumR += r; sumG += g; sumB += b; ++count;
-    }
-  }
+  const roi_stats_t &st = f->center;
 
-  uint8_t r = (count ? sumR / count : 0);
-  uint8_t g = (count ? sumG / count : 0);
-  uint8_t b = (count ? sumB / count : 0);
+  uint8_t r = (st.count ? st.sum[0] / st.count : 0);
+  uint8_t g = (st.count ? st.sum[1] / st.count : 0);
+  uint8_t b = (st.count ? st.sum[2] / st.count : 0);
   const char* name = nearest_color_name(r, g, b);
 
   Serial.printf("Center~%dx%d avg RGB=(%3u,%3u,%3u)  WxH=%ux%u  Mode=%s  Color≈%s\n",
@@ -420,23 +730,106 @@ void loop() {
 #endif
                 name);
 
-  esp_camera_fb_return(fb);
+  frame_release(f);
   delay(250);
 }
 
+// ==============================
+// Async workers
+// ==============================
+// A request handed over with httpd_req_async_handler_begin() keeps its
+// socket while the httpd task goes back to serving other clients, so a
+// slow link only ever stalls the worker sending to it.
+static_assert(MAX_STREAMS < ASYNC_WORKERS, "streams would starve frame downloads");
+static_assert(MAX_DOWNLOADS >= 1, "downloads need a frame buffer of their own");
+
+struct AsyncJob {
+  httpd_req_t *req;
+  esp_err_t (*handler)(httpd_req_t *req);
+};
+
+static QueueHandle_t async_jobs = NULL;
+static SemaphoreHandle_t async_free = NULL;    // idle workers
+static SemaphoreHandle_t stream_slots = NULL;  // streams still allowed
+static SemaphoreHandle_t download_slots = NULL;  // whole-frame downloads still allowed
+static SemaphoreHandle_t jpeg_lock = NULL;     // frame2jpg's tables are global
+static TaskHandle_t async_tasks[ASYNC_WORKERS];
+
+// Index of the calling worker, or -1 on any other task
+static int async_worker_index() {
+  const TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < ASYNC_WORKERS; ++i) {
+    if (async_tasks[i] == me) return i;
+  }
+  return -1;
+}
+
+static void async_worker(void *arg) {
+  (void)arg;
+  for (;;) {
+    AsyncJob job;
+    if (xQueueReceive(async_jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+    job.handler(job.req);
+    httpd_req_async_handler_complete(job.req);
+    xSemaphoreGive(async_free);
+  }
+}
+
+static bool async_start() {
+  async_jobs = xQueueCreate(ASYNC_WORKERS, sizeof(AsyncJob));
+  async_free = xSemaphoreCreateCounting(ASYNC_WORKERS, ASYNC_WORKERS);
+  stream_slots = xSemaphoreCreateCounting(MAX_STREAMS, MAX_STREAMS);
+  download_slots = xSemaphoreCreateCounting(MAX_DOWNLOADS, MAX_DOWNLOADS);
+  jpeg_lock = xSemaphoreCreateMutex();
+  if (!async_jobs || !async_free || !stream_slots || !download_slots || !jpeg_lock) return false;
+  for (int i = 0; i < ASYNC_WORKERS; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "http_async%d", i);
+    if (xTaskCreate(async_worker, name, ASYNC_WORKER_STACK, NULL, 5, &async_tasks[i]) != pdPASS) return false;
+  }
+  return true;
+}
+
+static esp_err_t send_busy(httpd_req_t *req) {
+  httpd_resp_set_status(req, "503 Service Unavailable");
+  httpd_resp_set_hdr(req, "Retry-After", "1");
+  return httpd_resp_send(req, "Busy, try again", HTTPD_RESP_USE_STRLEN);
+}
+
+// Hands req to an idle worker to run handler on. False, with nothing sent,
+// if no worker is free.
+static bool async_submit(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req)) {
+  if (!async_jobs || xSemaphoreTake(async_free, 0) != pdTRUE) return false;
+
+  httpd_req_t *copy = NULL;
+  if (httpd_req_async_handler_begin(req, &copy) != ESP_OK) {
+    xSemaphoreGive(async_free);
+    return false;
+  }
+  // Can't fail: the queue holds as many jobs as there are workers
+  AsyncJob job = { copy, handler };
+  xQueueSend(async_jobs, &job, 0);
+  return true;
+}
+
+static esp_err_t async_dispatch(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req)) {
+  return async_submit(req, handler) ? ESP_OK : send_busy(req);
+}
+
 // HTTP server handler: serve frame as PPM (binary P6).
 static esp_err_t frame_handler(httpd_req_t *req) {
   Serial.printf("Frame request: %s\n", req->uri ? req->uri : "NULL");
   
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb) {
-    Serial.println("Failed to get frame buffer");
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) {
+    Serial.println("No frame from the capture task");
     httpd_resp_send_500(req);
     return ESP_FAIL;
   }
+  camera_fb_t *fb = f->fb;
 
   if (fb->format != PIXFORMAT_RGB565) {
-    esp_camera_fb_return(fb);
+    frame_release(f);
     httpd_resp_set_status(req, "415 Unsupported Media Type");
     httpd_resp_send(req, "Need RGB565 frame", HTTPD_RESP_USE_STRLEN);
     return ESP_FAIL;
@@ -450,30 +843,41 @@ static esp_err_t frame_handler(httpd_req_t *req) {
   httpd_resp_set_type(req, "image/x-portable-pixmap");
   // send header as first chunk
   if (httpd_resp_send_chunk(req, hdr, hdr_len) != ESP_OK) {
-    esp_camera_fb_return(fb);
+    frame_release(f);
     return ESP_FAIL;
   }
 
-  const uint8_t* buf8 = reinterpret_cast<const uint8_t*>(fb->buf);
   // Many camera drivers provide a stride (padding) per row. Compute bytes-per-row from fb->len
   size_t stride_bytes = 0;
   if (fb->height > 0) stride_bytes = fb->len / fb->height; // bytes per row (may include padding)
   if (stride_bytes == 0) stride_bytes = size_t(w) * 2;
+  // Pixels actually present per row; the rest of a row is sent black
+  const int n_px = int(min(size_t(w), stride_bytes / 2));
 
-  const size_t row_buf_size = size_t(w) * 3;
-  uint8_t *row_buf = (uint8_t*)malloc(row_buf_size);
-  if (!row_buf) {
-    esp_camera_fb_return(fb);
+  // One buffer per worker, kept between requests
+  static uint8_t *ppm_bufs[ASYNC_WORKERS];
+  static size_t ppm_buf_sizes[ASYNC_WORKERS];
+  const int wi = async_worker_index();
+  if (wi < 0) {
+    frame_release(f);
     httpd_resp_send_500(req);
     return ESP_FAIL;
   }
-
-  // pixels_per_row derived from stride; we will clamp to fb->width
-  size_t pixels_per_row = stride_bytes / 2;
-  if (pixels_per_row < w) {
-    // stride smaller than width: we'll still iterate upto pixels_per_row to avoid OOB
-    // but write only up to w to the row buffer (remaining pixels will be black)
+  uint8_t *&ppm_buf = ppm_bufs[wi];
+  size_t &ppm_buf_size = ppm_buf_sizes[wi];
+  const size_t row_bytes = size_t(w) * 3;
+  if (ppm_buf_size < row_bytes * PPM_ROWS_PER_CHUNK) {
+    free(ppm_buf);
+    ppm_buf_size = row_bytes * PPM_ROWS_PER_CHUNK;
+    ppm_buf = (uint8_t*)malloc(ppm_buf_size);
+    if (!ppm_buf) ppm_buf_size = 0;
+  }
+  if (!ppm_buf) {
+    frame_release(f);
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
   }
+  if (n_px < w) memset(ppm_buf, 0, ppm_buf_size);
 
   // Use auto-detected format, with optional query override
   PixelFormat use_format = detected_format;
@@ -491,35 +895,213 @@ static esp_err_t frame_handler(httpd_req_t *req) {
     }
   }
 
-  for (uint16_t y = 0; y < h; ++y) {
-    size_t row_byte = size_t(y) * stride_bytes;
-    // clear row buffer to black to avoid remnants if stride < w
-    memset(row_buf, 0, row_buf_size);
-    for (uint16_t x = 0; x < w; ++x) {
-      size_t pix_idx = row_byte + size_t(x) * 2;
-      if (pix_idx + 1 >= fb->len) {
-        // out of bounds, leave black
-        continue;
-      }
-      // assemble little-endian 16-bit pixel (low byte first)
-      uint16_t pix = uint16_t(buf8[pix_idx]) | (uint16_t(buf8[pix_idx + 1]) << 8);
-      uint8_t R, G, B;
-      rgb565_to_rgb888_format(pix, R, G, B, use_format);
-      row_buf[x*3 + 0] = R;
-      row_buf[x*3 + 1] = G;
-      row_buf[x*3 + 2] = B;
+  const RowConverter convert = ROW_CONVERTERS[use_format];
+  for (uint16_t y0 = 0; y0 < h; y0 += PPM_ROWS_PER_CHUNK) {
+    const int rows = min(int(h - y0), PPM_ROWS_PER_CHUNK);
+    for (int i = 0; i < rows; ++i) {
+      convert(fb->buf + size_t(y0 + i) * stride_bytes, ppm_buf + i * row_bytes, n_px);
     }
-    if (httpd_resp_send_chunk(req, (const char*)row_buf, row_buf_size) != ESP_OK) {
+    if (httpd_resp_send_chunk(req, (const char*)ppm_buf, rows * row_bytes) != ESP_OK) {
       break;
     }
   }
 
-  free(row_buf);
-  esp_camera_fb_return(fb);
+  frame_release(f);
   httpd_resp_send_chunk(req, NULL, 0); // end of response
   return ESP_OK;
 }
 
+// Integer query parameter ?key=N clamped to [lo, hi], or def when absent
+static int query_int(httpd_req_t *req, const char *key, int def, int lo, int hi) {
+  char query[64], val[12];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) return def;
+  if (httpd_query_key_value(query, key, val, sizeof(val)) != ESP_OK) return def;
+  return constrain(atoi(val), lo, hi);
+}
+
+// /frame.raw header, little-endian like the ESP32. Decoded by rawframe.py.
+struct RawFrameHeader {
+  char magic[4];      // "R565"
+  uint16_t width;
+  uint16_t height;
+  uint32_t stride;    // bytes per row
+  uint8_t format;     // PixelFormat
+  uint8_t reserved[3];
+};
+static_assert(sizeof(RawFrameHeader) == 16, "raw frame header layout");
+
+// The frame buffer as it is, with no conversion; the client unpacks RGB565.
+// ?fmt=0..3 overrides the detected PixelFormat in the header.
+static esp_err_t raw_frame_handler(httpd_req_t *req) {
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) { httpd_resp_send_500(req); return ESP_FAIL; }
+  camera_fb_t *fb = f->fb;
+  if (fb->format != PIXFORMAT_RGB565) {
+    frame_release(f);
+    httpd_resp_set_status(req, "415 Unsupported Media Type");
+    httpd_resp_send(req, "Need RGB565 frame", HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL;
+  }
+
+  RawFrameHeader hdr = {};
+  memcpy(hdr.magic, "R565", 4);
+  hdr.width = fb->width;
+  hdr.height = fb->height;
+  hdr.stride = (fb->height > 0) ? fb->len / fb->height : uint32_t(fb->width) * 2;
+  hdr.format = uint8_t(query_int(req, "fmt", detected_format, 0, FMT_COUNT - 1));
+  const size_t len = size_t(hdr.stride) * hdr.height;
+
+  httpd_resp_set_type(req, "application/octet-stream");
+  esp_err_t res = httpd_resp_send_chunk(req, (const char *)&hdr, sizeof(hdr));
+  for (size_t off = 0; res == ESP_OK && off < len; off += RAW_CHUNK_BYTES) {
+    const size_t n = min(len - off, size_t(RAW_CHUNK_BYTES));
+    res = httpd_resp_send_chunk(req, (const char *)fb->buf + off, n);
+  }
+  frame_release(f);
+  if (res == ESP_OK) httpd_resp_send_chunk(req, NULL, 0);
+  return res;
+}
+
+// The frame box-filtered down by ?scale=2..8, as binary PPM or, with
+// ?jpeg=1, as JPEG at quality ?q=. The frame is only held while it's read;
+// ?fmt=0..3 overrides the detected PixelFormat.
+static esp_err_t preview_handler(httpd_req_t *req) {
+  const int scale = query_int(req, "scale", PREVIEW_DEFAULT_SCALE, 2, PREVIEW_MAX_SCALE);
+  const bool jpeg = query_int(req, "jpeg", 0, 0, 1);
+  const int quality = query_int(req, "q", STREAM_JPEG_QUALITY, 1, 100);
+  const PixelFormat fmt = PixelFormat(query_int(req, "fmt", detected_format, 0, FMT_COUNT - 1));
+
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) { httpd_resp_send_500(req); return ESP_FAIL; }
+  camera_fb_t *fb = f->fb;
+  if (fb->format != PIXFORMAT_RGB565) {
+    frame_release(f);
+    httpd_resp_set_status(req, "415 Unsupported Media Type");
+    httpd_resp_send(req, "Need RGB565 frame", HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL;
+  }
+
+  size_t stride_bytes = (fb->height > 0) ? fb->len / fb->height : size_t(fb->width) * 2;
+  const int n_px = int(min(size_t(fb->width), stride_bytes / 2));
+  const int out_w = n_px / scale, out_h = int(fb->height) / scale;
+  const size_t img_len = size_t(out_w) * out_h * 3;
+
+  // Image in PSRAM, column sums in internal RAM where the inner loop is
+  uint8_t *img = (uint8_t *)heap_caps_malloc(img_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  uint32_t *acc = (uint32_t *)malloc(size_t(out_w) * 2 * sizeof(uint32_t));
+  if (!img || !acc || out_w == 0 || out_h == 0) {
+    frame_release(f);
+    free(img);
+    free(acc);
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  uint32_t *acc_hl = acc, *acc_g = acc + out_w;
+
+  // fmt2jpg takes RGB888 as B,G,R in memory; the PPM is R,G,B
+  const bool bgr_in = (fmt == FMT_BGR565_LE || fmt == FMT_BGR565_BE);
+  const int hi_o = (bgr_in == jpeg) ? 0 : 2;
+  const uint32_t n2 = uint32_t(scale) * scale;
+  const uint32_t q5 = box_scale_q16(31, n2), q6 = box_scale_q16(63, n2);
+  const BoxAccumulator accumulate = BOX_ACCUMULATORS[fmt];
+
+  for (int oy = 0; oy < out_h; ++oy) {
+    memset(acc, 0, size_t(out_w) * 2 * sizeof(uint32_t));
+    for (int k = 0; k < scale; ++k) {
+      accumulate(fb->buf + size_t(oy * scale + k) * stride_bytes, out_w, scale, acc_hl, acc_g);
+    }
+    box_row_finish(acc_hl, acc_g, out_w, q5, q6, hi_o, img + size_t(oy) * out_w * 3);
+  }
+  frame_release(f);
+  free(acc);
+
+  esp_err_t res;
+  if (jpeg) {
+    uint8_t *jpg = NULL;
+    size_t jpg_len = 0;
+    xSemaphoreTake(jpeg_lock, portMAX_DELAY);
+    const bool ok = fmt2jpg(img, img_len, out_w, out_h, PIXFORMAT_RGB888, quality, &jpg, &jpg_len);
+    xSemaphoreGive(jpeg_lock);
+    free(img);
+    if (!ok) { httpd_resp_send_500(req); return ESP_FAIL; }
+    httpd_resp_set_type(req, "image/jpeg");
+    res = httpd_resp_send(req, (const char *)jpg, jpg_len);
+    free(jpg);
+    return res;
+  }
+
+  char hdr[32];
+  const int hdr_len = snprintf(hdr, sizeof(hdr), "P6\n%d %d\n255\n", out_w, out_h);
+  httpd_resp_set_type(req, "image/x-portable-pixmap");
+  res = httpd_resp_send_chunk(req, hdr, hdr_len);
+  if (res == ESP_OK) res = httpd_resp_send_chunk(req, (const char *)img, img_len);
+  if (res == ESP_OK) httpd_resp_send_chunk(req, NULL, 0);
+  free(img);
+  return res;
+}
+
+#define PART_BOUNDARY "colormetricframe"
+static const char *STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char *STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+static const char *STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+
+// MJPEG stream: the sensor's JPEG as is when the camera runs in JPEG mode,
+// otherwise each frame through frame2jpg. Runs until the client goes away.
+static esp_err_t stream_handler(httpd_req_t *req) {
+  const int quality = query_int(req, "q", STREAM_JPEG_QUALITY, 1, 100);
+  const int fps = query_int(req, "fps", STREAM_MAX_FPS, 1, 60);
+  const uint32_t period_ms = 1000 / fps;
+  Serial.printf("Stream start: quality %d, max %d fps\n", quality, fps);
+
+  httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  esp_err_t res = ESP_OK;
+  uint32_t last_ms = 0, last_seq = 0, frames = 0, t0 = millis();
+  while (res == ESP_OK) {
+    const uint32_t since = millis() - last_ms;
+    if (last_ms && since < period_ms) delay(period_ms - since);
+    last_ms = millis();
+
+    // Never the same frame twice. A late frame isn't the end of the
+    // stream; a gone client shows up when the next one is sent.
+    SharedFrame *f = frame_acquire_newer(last_seq, FRAME_WAIT_MS);
+    if (!f) continue;
+    last_seq = f->seq;
+
+    uint8_t *jpg = f->fb->buf;
+    size_t jpg_len = f->fb->len;
+    bool converted = false;
+    if (f->fb->format != PIXFORMAT_JPEG) {
+      xSemaphoreTake(jpeg_lock, portMAX_DELAY);
+      converted = frame2jpg(f->fb, quality, &jpg, &jpg_len);
+      xSemaphoreGive(jpeg_lock);
+      // Encoded copy made; drop the frame while it's sent
+      frame_release(f);
+      f = NULL;
+      if (!converted) {
+        res = ESP_FAIL;
+        break;
+      }
+    }
+
+    char part[64];
+    const int part_len = snprintf(part, sizeof(part), STREAM_PART, (unsigned)jpg_len);
+    res = httpd_resp_send_chunk(req, STREAM_BOUNDARY, strlen(STREAM_BOUNDARY));
+    if (res == ESP_OK) res = httpd_resp_send_chunk(req, part, part_len);
+    if (res == ESP_OK) res = httpd_resp_send_chunk(req, (const char *)jpg, jpg_len);
+
+    frame_release(f);
+    if (converted) free(jpg);
+    frames++;
+  }
+
+  const uint32_t elapsed = millis() - t0;
+  Serial.printf("Stream end: %u frames, %.1f fps\n", (unsigned)frames,
+                elapsed ? frames * 1000.0f / elapsed : 0.0f);
+  return res;
+}
+
 // Camera settings handler
 static esp_err_t settings_handler(httpd_req_t *req) {
   sensor_t *s = esp_camera_sensor_get();
@@ -561,47 +1143,255 @@ static esp_err_t settings_handler(httpd_req_t *req) {
   return ESP_OK;
 }
 
+// Per-channel mean and standard deviation of a window, 8-bit units
+static void stats_mean_sd(const roi_stats_t &st, float mean[3], float sd[3]) {
+  for (int c = 0; c < 3; ++c) {
+    mean[c] = st.count ? float(st.sum[c]) / st.count : 0;
+    float var = st.count ? float(st.sumsq[c]) / st.count - mean[c] * mean[c] : 0;
+    sd[c] = var > 0 ? sqrtf(var) : 0;
+  }
+}
+
 // simple index handler
 static esp_err_t color_handler(httpd_req_t *req) {
-  // capture a frame and compute center average RGB
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb) { httpd_resp_send_500(req); return ESP_FAIL; }
-  if (fb->format != PIXFORMAT_RGB565) { esp_camera_fb_return(fb); httpd_resp_send_500(req); return ESP_FAIL; }
+  // center window of the latest frame, measured by the capture task
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) { httpd_resp_send_500(req); return ESP_FAIL; }
+  if (!f->stats_valid) { frame_release(f); httpd_resp_send_500(req); return ESP_FAIL; }
 
-  const uint16_t w = fb->width;
-  const uint16_t h = fb->height;
-  const uint16_t cx = w / 2;
-  const uint16_t cy = h / 2;
-  const int R = AVG_RADIUS;
-  const uint8_t* buf8 = reinterpret_cast<const uint8_t*>(fb->buf);
-  size_t stride_bytes = (fb->height > 0) ? fb->len / fb->height : size_t(w) * 2;
+  // ?hist=1 adds the 32-bin per-channel histograms of the window
+  bool want_hist = req->uri && strstr(req->uri, "hist=1");
 
-  uint32_t sumR=0,sumG=0,sumB=0; uint16_t count=0;
-  for (int dy=-R; dy<=R; ++dy) {
-    int y = int(cy) + dy; if (y<0||y>=h) continue;
-    size_t row_byte = size_t(y) * stride_bytes;
-    for (int dx=-R; dx<=R; ++dx) {
-      int x = int(cx) + dx; if (x<0||x>=w) continue;
-      size_t pix_idx = row_byte + size_t(x)*2;
-      if (pix_idx+1 >= fb->len) continue;
-      uint16_t pix = uint16_t(buf8[pix_idx]) | (uint16_t(buf8[pix_idx+1])<<8);
-      uint8_t rr,gg,bb; rgb565_to_rgb888_format(pix, rr,gg,bb, detected_format);
-      sumR += rr; sumG += gg; sumB += bb; ++count;
+  const roi_stats_t st = f->center;
+  frame_release(f);
+
+  const uint32_t count = st.count;
+  uint8_t ar = (count? st.sum[0]/count:0);
+  uint8_t ag = (count? st.sum[1]/count:0);
+  uint8_t ab = (count? st.sum[2]/count:0);
+  const char* name = nearest_color_name(ar,ag,ab);
+
+  // Per-channel standard deviation over the window
+  float mean[3], sd[3];
+  stats_mean_sd(st, mean, sd);
+
+  char buf[1024];
+  int n = snprintf(buf, sizeof(buf),
+    "{\"r\":%u,\"g\":%u,\"b\":%u,\"name\":\"%s\",\"sd\":[%.2f,%.2f,%.2f]",
+    (unsigned)ar, (unsigned)ag, (unsigned)ab, name, sd[0], sd[1], sd[2]);
+  if (want_hist) {
+    const char* keys[3] = {"hist_r", "hist_g", "hist_b"};
+    for (int c = 0; c < 3; ++c) {
+      n += snprintf(buf + n, sizeof(buf) - n, ",\"%s\":[", keys[c]);
+      for (int k = 0; k < ROI_STATS_BINS; ++k) {
+        n += snprintf(buf + n, sizeof(buf) - n, k ? ",%u" : "%u", (unsigned)st.hist[c][k]);
+      }
+      n += snprintf(buf + n, sizeof(buf) - n, "]");
     }
   }
-  uint8_t ar = (count? sumR/count:0);
-  uint8_t ag = (count? sumG/count:0);
-  uint8_t ab = (count? sumB/count:0);
-  const char* name = nearest_color_name(ar,ag,ab);
-  esp_camera_fb_return(fb);
+  n += snprintf(buf + n, sizeof(buf) - n, "}");
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_send(req, buf, n);
+  return ESP_OK;
+}
 
-  char buf[128];
-  int n = snprintf(buf, sizeof(buf), "{\"r\":%u,\"g\":%u,\"b\":%u,\"name\":\"%s\"}", (unsigned)ar, (unsigned)ag, (unsigned)ab, name);
+// Every region of the sensor's ROI table, evaluated in one pass over the frame
+static esp_err_t rois_handler(httpd_req_t *req) {
+  SharedFrame *f = frame_acquire_newer(0, FRAME_WAIT_MS);
+  if (!f) { httpd_resp_send_500(req); return ESP_FAIL; }
+  if (!f->stats_valid) { frame_release(f); httpd_resp_send_500(req); return ESP_FAIL; }
+
+  // Handlers run one at a time on the httpd task
+  static roi_stats_t stats[ROI_COUNT];
+  memcpy(stats, f->rois, sizeof(stats));
+  frame_release(f);
+
+  static const char* roles[] = {"sample", "white", "black"};
+  static char buf[160 * ROI_MAX + 16];
+  int n = snprintf(buf, sizeof(buf), "[");
+  for (int i = 0; i < ROI_COUNT; ++i) {
+    const roi_stats_t &st = stats[i];
+    const roi_def_t &d = ROI_TABLE[i];
+    unsigned r = st.count ? st.sum[0] / st.count : 0;
+    unsigned g = st.count ? st.sum[1] / st.count : 0;
+    unsigned b = st.count ? st.sum[2] / st.count : 0;
+    n += snprintf(buf + n, sizeof(buf) - n,
+      "%s{\"role\":\"%s\",\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d,\"n\":%u,\"r\":%u,\"g\":%u,\"b\":%u}",
+      i ? "," : "", roles[d.role], d.x, d.y, d.w, d.h, (unsigned)st.count, r, g, b);
+  }
+  n += snprintf(buf + n, sizeof(buf) - n, "]");
   httpd_resp_set_type(req, "application/json");
   httpd_resp_send(req, buf, n);
   return ESP_OK;
 }
 
+// ==============================
+// WebSocket telemetry
+// ==============================
+// The capture task's stats pushed to /ws clients as frames come in, so a
+// live plot doesn't cost a request per sample. The ws_push task does the
+// sending itself: a stalled client holds it up for the socket's send
+// timeout, never the httpd task. The client table is shared with the
+// handshake and message handler and kept under ws_mux.
+struct WsClient {
+  int fd;              // -1 = free slot
+  uint32_t period_ms;
+  uint32_t next_ms;
+};
+
+static WsClient ws_clients[WS_MAX_CLIENTS];
+static volatile int ws_client_count = 0;
+static portMUX_TYPE ws_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#define WS_RECORD_BYTES (192 + 64 * ROI_COUNT)
+
+// Adds the client on socket fd, or changes its rate if it's already in
+static bool ws_client_set(int fd, int hz) {
+  bool ok = false;
+  portENTER_CRITICAL(&ws_mux);
+  WsClient *slot = NULL;
+  for (int i = 0; i < WS_MAX_CLIENTS; ++i) {
+    if (ws_clients[i].fd == fd) { slot = &ws_clients[i]; break; }
+    if (!slot && ws_clients[i].fd < 0) slot = &ws_clients[i];
+  }
+  if (slot) {
+    if (slot->fd != fd) ws_client_count++;
+    slot->fd = fd;
+    slot->period_ms = 1000 / hz;
+    slot->next_ms = millis();
+    ok = true;
+  }
+  portEXIT_CRITICAL(&ws_mux);
+  return ok;
+}
+
+static void ws_client_drop(int fd) {
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS; ++i) {
+    if (ws_clients[i].fd != fd) continue;
+    ws_clients[i].fd = -1;
+    ws_client_count--;
+  }
+  portEXIT_CRITICAL(&ws_mux);
+}
+
+// Sends the record to every client whose next slot has come. Clients are
+// picked under the lock and sent to without it.
+static void ws_send_due(const char *record, size_t len) {
+  int due[WS_MAX_CLIENTS];
+  int n = 0;
+  const uint32_t now = millis();
+  portENTER_CRITICAL(&ws_mux);
+  for (int i = 0; i < WS_MAX_CLIENTS; ++i) {
+    WsClient &c = ws_clients[i];
+    if (c.fd < 0 || int32_t(now - c.next_ms) < 0) continue;
+    due[n++] = c.fd;
+    // Keep to the schedule, but start over after a gap rather than burst
+    c.next_ms += c.period_ms;
+    if (int32_t(now - c.next_ms) >= 0) c.next_ms = now + c.period_ms;
+  }
+  portEXIT_CRITICAL(&ws_mux);
+
+  for (int k = 0; k < n; ++k) {
+    // Gone since the last record; the fd may be another client's by now
+    if (httpd_ws_get_fd_info(server, due[k]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+      ws_client_drop(due[k]);
+      continue;
+    }
+    httpd_ws_frame_t frame = {};
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_TEXT;
+    frame.payload = (uint8_t *)record;
+    frame.len = len;
+    if (httpd_ws_send_frame_async(server, due[k], &frame) != ESP_OK) {
+      httpd_sess_trigger_close(server, due[k]);
+      ws_client_drop(due[k]);
+    }
+  }
+}
+
+static size_t ws_format(const SharedFrame *f, char *buf, size_t len) {
+  float mean[3], sd[3];
+  stats_mean_sd(f->center, mean, sd);
+  const struct timeval &ts = f->fb->timestamp;
+  const uint32_t t_ms = uint32_t(ts.tv_sec) * 1000 + uint32_t(ts.tv_usec) / 1000;
+  const char *name = nearest_color_name(uint8_t(mean[0]), uint8_t(mean[1]), uint8_t(mean[2]));
+
+  int n = snprintf(buf, len,
+    "{\"seq\":%u,\"t\":%u,\"name\":\"%s\",\"mean\":[%.1f,%.1f,%.1f],\"sd\":[%.1f,%.1f,%.1f],\"rois\":[",
+    (unsigned)f->seq, (unsigned)t_ms, name, mean[0], mean[1], mean[2], sd[0], sd[1], sd[2]);
+  for (int i = 0; i < ROI_COUNT; ++i) {
+    stats_mean_sd(f->rois[i], mean, sd);
+    n += snprintf(buf + n, len - n, "%s{\"mean\":[%.1f,%.1f,%.1f],\"sd\":[%.1f,%.1f,%.1f]}",
+                  i ? "," : "", mean[0], mean[1], mean[2], sd[0], sd[1], sd[2]);
+  }
+  n += snprintf(buf + n, len - n, "]}");
+  return min(size_t(n), len - 1);
+}
+
+// Formats each new frame's record once and sends it to the clients due one
+static void ws_task(void *arg) {
+  (void)arg;
+  static char record[WS_RECORD_BYTES];
+  uint32_t seq = 0;
+  for (;;) {
+    if (ws_client_count == 0) {
+      delay(100);
+      continue;
+    }
+    SharedFrame *f = frame_acquire_newer(seq, FRAME_WAIT_MS);
+    if (!f) continue;
+    seq = f->seq;
+
+    const bool valid = f->stats_valid;
+    const size_t len = valid ? ws_format(f, record, sizeof(record)) : 0;
+    frame_release(f);
+    if (valid) ws_send_due(record, len);
+  }
+}
+
+static esp_err_t ws_handler(httpd_req_t *req) {
+  const int fd = httpd_req_to_sockfd(req);
+  if (req->method == HTTP_GET) {
+    // Handshake done
+    if (ws_client_set(fd, query_int(req, "hz", WS_DEFAULT_HZ, 1, WS_MAX_HZ))) return ESP_OK;
+    Serial.println("WebSocket refused, too many clients");
+    return ESP_FAIL;
+  }
+
+  // Only "hz=N" is understood; anything else is read and ignored
+  httpd_ws_frame_t frame = {};
+  esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+  if (err != ESP_OK) return err;
+  char text[16] = {};
+  if (frame.len >= sizeof(text)) return ESP_ERR_INVALID_SIZE;
+  if (frame.len == 0) return ESP_OK;
+  frame.payload = (uint8_t *)text;
+  err = httpd_ws_recv_frame(req, &frame, frame.len);
+  if (err != ESP_OK) return err;
+  if (frame.type == HTTPD_WS_TYPE_TEXT && strncmp(text, "hz=", 3) == 0) {
+    ws_client_set(fd, constrain(atoi(text + 3), 1, WS_MAX_HZ));
+  }
+  return ESP_OK;
+}
+
+static bool ws_start() {
+  if (!server) return false;
+  for (int i = 0; i < WS_MAX_CLIENTS; ++i) ws_clients[i].fd = -1;
+  httpd_uri_t ws_uri = {
+    .uri = "/ws",
+    .method = HTTP_GET,
+    .handler = ws_handler,
+    .user_ctx = NULL,
+    .is_websocket = true
+  };
+  if (httpd_register_uri_handler(server, &ws_uri) != ESP_OK) return false;
+  return xTaskCreate(ws_task, "ws_push", 4096, NULL, 3, NULL) == pdPASS;
+}
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
 static esp_err_t index_handler(httpd_req_t *req) {
   const char* html = 
     "<html><head><title>ESP Camera Debug</title></head><body>"
@@ -610,17 +1400,86 @@ static esp_err_t index_handler(httpd_req_t *req) {
     "<p>Endpoints:</p>"
     "<ul>"
     "<li><a href=\"/frame.ppm\">/frame.ppm</a> - Current frame</li>"
+    "<li><a href=\"/frame.raw\">/frame.raw</a> - Current frame, raw RGB565 (decode with rawframe.py)</li>"
+    "<li><a href=\"/preview?jpeg=1\">/preview</a> - Downscaled frame, box-filtered (?scale=2-" STR(PREVIEW_MAX_SCALE) ", ?jpeg=1, ?q=)</li>"
+    "<li><a id=\"stream\" href=\"#\">:" STR(STREAM_PORT) "/stream</a> - Live MJPEG (?q=1-100, ?fps=N)</li>"
     "<li><a href=\"/color.json\">/color.json</a> - Color analysis</li>"
+    "<li><a href=\"/rois.json\">/rois.json</a> - Sensor ROI table</li>"
     "<li><a href=\"/settings\">/settings</a> - Camera settings</li>"
+    "<li>/ws - WebSocket, one JSON record per frame (?hz=1-" STR(WS_MAX_HZ) ")</li>"
     "</ul>"
+    "<p id=\"live\"></p>"
+    "<script>document.getElementById('stream').href="
+    "location.protocol+'//'+location.hostname+':" STR(STREAM_PORT) "/stream';"
+    "var ws=new WebSocket('ws://'+location.host+'/ws?hz=2');"
+    "ws.onmessage=function(e){var d=JSON.parse(e.data);"
+    "document.getElementById('live').textContent='Center: '+d.name+' RGB='+d.mean.join(',');};"
+    "</script>"
     "</body></html>";
   httpd_resp_set_type(req, "text/html");
   httpd_resp_send(req, html, HTTPD_RESP_USE_STRLEN);
   return ESP_OK;
 }
 
+// Entry points of the long transfers: hand the request to a worker.
+// Whole-frame downloads hold their frame until sent, so they also need one
+// of the download slots.
+static esp_err_t frame_job(httpd_req_t *req) {
+  const esp_err_t err = frame_handler(req);
+  xSemaphoreGive(download_slots);
+  return err;
+}
+
+static esp_err_t raw_frame_job(httpd_req_t *req) {
+  const esp_err_t err = raw_frame_handler(req);
+  xSemaphoreGive(download_slots);
+  return err;
+}
+
+static esp_err_t download_dispatch(httpd_req_t *req, esp_err_t (*job)(httpd_req_t *req)) {
+  if (!download_slots || xSemaphoreTake(download_slots, 0) != pdTRUE) return send_busy(req);
+  if (async_submit(req, job)) return ESP_OK;
+  xSemaphoreGive(download_slots);
+  return send_busy(req);
+}
+
+static esp_err_t frame_async(httpd_req_t *req) {
+  return download_dispatch(req, frame_job);
+}
+
+static esp_err_t raw_frame_async(httpd_req_t *req) {
+  return download_dispatch(req, raw_frame_job);
+}
+
+static esp_err_t preview_async(httpd_req_t *req) {
+  return async_dispatch(req, preview_handler);
+}
+
+static esp_err_t stream_job(httpd_req_t *req) {
+  const esp_err_t err = stream_handler(req);
+  xSemaphoreGive(stream_slots);
+  return err;
+}
+
+static esp_err_t stream_async(httpd_req_t *req) {
+  if (!stream_slots || xSemaphoreTake(stream_slots, 0) != pdTRUE) return send_busy(req);
+  if (async_submit(req, stream_job)) return ESP_OK;
+  xSemaphoreGive(stream_slots);
+  return send_busy(req);
+}
+
 // register handlers after server start
 static void register_uri_handlers() {
+  if (stream_server) {
+    httpd_uri_t stream_uri = {
+      .uri = "/stream",
+      .method = HTTP_GET,
+      .handler = stream_async,
+      .user_ctx = NULL
+    };
+    httpd_register_uri_handler(stream_server, &stream_uri);
+  }
+
   if (!server) return;
   httpd_uri_t idx_uri = {
     .uri = "/",
@@ -633,10 +1492,26 @@ static void register_uri_handlers() {
   httpd_uri_t frame_uri = {
     .uri = "/frame.ppm",
     .method = HTTP_GET,
-    .handler = frame_handler,
+    .handler = frame_async,
     .user_ctx = NULL
   };
   httpd_register_uri_handler(server, &frame_uri);
+
+  httpd_uri_t raw_uri = {
+    .uri = "/frame.raw",
+    .method = HTTP_GET,
+    .handler = raw_frame_async,
+    .user_ctx = NULL
+  };
+  httpd_register_uri_handler(server, &raw_uri);
+
+  httpd_uri_t preview_uri = {
+    .uri = "/preview",
+    .method = HTTP_GET,
+    .handler = preview_async,
+    .user_ctx = NULL
+  };
+  httpd_register_uri_handler(server, &preview_uri);
   httpd_uri_t color_uri = {
     .uri = "/color.json",
     .method = HTTP_GET,
@@ -652,4 +1527,12 @@ static void register_uri_handlers() {
     .user_ctx = NULL
   };
   httpd_register_uri_handler(server, &settings_uri);
+
+  httpd_uri_t rois_uri = {
+    .uri = "/rois.json",
+    .method = HTTP_GET,
+    .handler = rois_handler,
+    .user_ctx = NULL
+  };
+  httpd_register_uri_handler(server, &rois_uri);
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+"""Decoding of the ESP's /frame.raw: a 16-byte header, then the RGB565 frame
+buffer exactly as the camera driver left it.
+
+Header (little-endian): b'R565', uint16 width, uint16 height, uint32 stride
+in bytes, uint8 pixel format (the firmware's PixelFormat), 3 bytes padding.
+"""
+import struct
+from array import array
+
+from PIL import Image
+
+HEADER = struct.Struct('<4sHHIB3x')
+MAGIC = b'R565'
+
+# PixelFormat in main.cpp
+FMT_RGB565_LE, FMT_BGR565_LE, FMT_RGB565_BE, FMT_BGR565_BE = range(4)
+FORMAT_NAMES = ['RGB565_LE', 'BGR565_LE', 'RGB565_BE', 'BGR565_BE']
+
+
+def parse_raw_frame(data):
+    """Returns (width, height, stride, fmt, pixels) from a /frame.raw body"""
+    if len(data) < HEADER.size:
+        raise ValueError('short raw frame')
+    magic, width, height, stride, fmt = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError(f'bad raw frame magic {magic!r}')
+    if fmt >= len(FORMAT_NAMES):
+        raise ValueError(f'unknown pixel format {fmt}')
+    pixels = memoryview(data)[HEADER.size:]
+    if len(pixels) < stride * height:
+        raise ValueError(f'raw frame has {len(pixels)} bytes, expected {stride * height}')
+    return width, height, stride, fmt, pixels
+
+
+def decode_raw_frame(data, fmt=None):
+    """RGB PIL image from a /frame.raw body. fmt overrides the header's format."""
+    width, height, stride, hdr_fmt, pixels = parse_raw_frame(data)
+    fmt = hdr_fmt if fmt is None else fmt
+    if fmt in (FMT_RGB565_BE, FMT_BGR565_BE):
+        swapped = array('H')
+        swapped.frombytes(bytes(pixels[:stride * height]))
+        swapped.byteswap()
+        pixels = swapped.tobytes()
+    # Pillow's 16-bit raw modes are little-endian; 'BGR;16' has red in the
+    # high bits, which is what the firmware calls RGB565
+    rawmode = 'BGR;16' if fmt in (FMT_RGB565_LE, FMT_RGB565_BE) else 'RGB;16'
+    return Image.frombuffer('RGB', (width, height), bytes(pixels[:stride * height]), 'raw', rawmode, stride, 1)
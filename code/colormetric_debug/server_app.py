@@ -4,11 +4,15 @@ Usage:
   pip install -r tools/requirements.txt
   python tools/server_app.py --esp http://192.168.4.1 --host 0.0.0.0 --port 5000
 
-The server fetches /frame.ppm and streams it to the browser, and forwards settings and color queries.
+The server relays the ESP's MJPEG /stream to the browser, decodes /frame.raw stills to PNG, and forwards settings and color queries.
 """
 from flask import Flask, Response, request, render_template_string, redirect, url_for
+from urllib.parse import urlsplit, urlunsplit
 import requests
 import argparse
+import io
+
+from rawframe import decode_raw_frame
 
 app = Flask(__name__)
 
@@ -23,19 +27,12 @@ INDEX_HTML = '''
 <body>
   <h2>ESP Camera (proxied)</h2>
   <div>
-    <img id="frame" src="/frame" alt="frame"/>
+    <img id="frame" src="/stream" alt="frame"/>
   </div>
   <p>
     <button onclick="fetch('/settings?brightness=0').then(()=>alert('sent'))">Reset Brightness</button>
     <button onclick="fetch('/color').then(r=>r.json()).then(j=>alert(JSON.stringify(j)))">Get Center Color</button>
   </p>
-  <script>
-    function refresh(){
-      const img = document.getElementById('frame');
-      img.src = '/frame?ts=' + Date.now();
-    }
-    setInterval(refresh, 1000);
-  </script>
 </body>
 </html>
 '''
@@ -46,15 +43,29 @@ def index():
 
 @app.route('/frame')
 def frame():
+    # Raw RGB565 from the ESP, unpacked here rather than on the device
     esp = app.config['ESP_BASE']
     params = dict(request.args)
     params['ts'] = params.get('ts', '')
     try:
-        r = requests.get(f"{esp}/frame.ppm", params=params, stream=True, timeout=10)
+        r = requests.get(f"{esp}/frame.raw", params=params, timeout=10)
+        r.raise_for_status()
+        img = decode_raw_frame(r.content)
     except Exception as e:
         return Response(f"Error fetching frame: {e}", status=502)
-    # stream content back
-    return Response(r.iter_content(chunk_size=4096), content_type=r.headers.get('Content-Type','application/octet-stream'))
+    out = io.BytesIO()
+    img.save(out, format='PNG')
+    return Response(out.getvalue(), content_type='image/png')
+
+@app.route('/stream')
+def stream():
+    # Multipart MJPEG from the ESP's stream server, relayed as it arrives
+    try:
+        r = requests.get(app.config['ESP_STREAM'], params=dict(request.args), stream=True, timeout=10)
+        r.raise_for_status()
+    except Exception as e:
+        return Response(f"Error opening stream: {e}", status=502)
+    return Response(r.iter_content(chunk_size=4096), content_type=r.headers.get('Content-Type'))
 
 @app.route('/color')
 def color():
@@ -81,7 +92,10 @@ if __name__ == '__main__':
     p.add_argument('--esp', default='http://192.168.4.1', help='Base URL of ESP device')
     p.add_argument('--host', default='127.0.0.1')
     p.add_argument('--port', type=int, default=5000)
+    p.add_argument('--stream-port', type=int, default=81, help='Port of the ESP stream server')
     args = p.parse_args()
     app.config['ESP_BASE'] = args.esp.rstrip('/')
+    u = urlsplit(app.config['ESP_BASE'])
+    app.config['ESP_STREAM'] = urlunsplit((u.scheme, f"{u.hostname}:{args.stream_port}", '/stream', '', ''))
     print('Starting proxy server. ESP base =', app.config['ESP_BASE'])
     app.run(host=args.host, port=args.port, debug=False)
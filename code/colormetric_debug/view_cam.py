@@ -1,12 +1,15 @@
 """ESP32 Camera Viewer with Live Preview and Controls
 
 Usage:
-  python view_cam.py                           # Live preview window
-  python view_cam.py --single                  # Single capture and show
+  python view_cam.py                           # Live preview window (MJPEG /stream)
+  python view_cam.py --single                  # Single capture and show (raw RGB565, decoded here)
+  python view_cam.py --single --ppm            # Same, with the device converting to PPM
+  python view_cam.py --single --scale 4        # 160x120 preview, box-filtered on the device
   python view_cam.py --save image.ppm          # Save frame to file
   python view_cam.py --settings brightness=1  # Adjust camera settings
+  python view_cam.py --telemetry --hz 5        # Print the /ws color records as they come
 
-Requirements: requests, pillow, tkinter (built-in)
+Requirements: requests, pillow, tkinter (built-in); websocket-client for /ws
 """
 import argparse
 import io
@@ -14,7 +17,7 @@ import sys
 import time
 import threading
 import json
-from urllib.parse import urlencode
+from urllib.parse import urlencode, urlsplit
 
 try:
     import requests
@@ -26,11 +29,69 @@ except Exception as e:
     print("Note: tkinter should be built-in with Python")
     raise
 
+try:
+    import websocket  # websocket-client; without it the viewer polls /color.json
+except ImportError:
+    websocket = None
+
+from rawframe import decode_raw_frame
+
+
+def stream_url(base_url, port=81):
+    """URL of /stream on the ESP's second server"""
+    u = urlsplit(base_url)
+    return f"{u.scheme}://{u.hostname}:{port}/stream"
+
+
+def iter_mjpeg(url, params=None, timeout=10):
+    """Yields the JPEG parts of a multipart/x-mixed-replace response as PIL images"""
+    r = requests.get(url, params=params, stream=True, timeout=timeout)
+    r.raise_for_status()
+    raw = r.raw
+    try:
+        while True:
+            length = None
+            while True:
+                line = raw.readline()
+                if not line:
+                    return
+                line = line.strip()
+                if not line and length is not None:
+                    break
+                if line.lower().startswith(b'content-length:'):
+                    length = int(line.split(b':', 1)[1])
+            data = raw.read(length)
+            if len(data) < length:
+                return
+            yield Image.open(io.BytesIO(data))
+    finally:
+        r.close()
+
+
+def ws_url(base_url, hz=None):
+    """URL of the ESP's /ws telemetry socket"""
+    url = f"ws://{urlsplit(base_url).netloc}/ws"
+    return f"{url}?hz={hz}" if hz else url
+
+
+def iter_telemetry(base_url, hz=None, timeout=10):
+    """Yields the per-frame records the ESP pushes on /ws, as dicts"""
+    if websocket is None:
+        raise RuntimeError("/ws telemetry needs websocket-client (pip install websocket-client)")
+    ws = websocket.create_connection(ws_url(base_url, hz), timeout=timeout)
+    try:
+        while True:
+            yield json.loads(ws.recv())
+    finally:
+        ws.close()
+
 
 class CameraViewer:
-    def __init__(self, base_url='http://192.168.4.1'):
+    def __init__(self, base_url='http://192.168.4.1', stream_port=81, quality=None, fps=None):
         self.base_url = base_url
-        self.frame_url = f"{base_url}/frame.ppm"
+        self.frame_url = f"{base_url}/frame.raw"
+        self.stream_url = stream_url(base_url, stream_port)
+        self.stream_params = {k: v for k, v in (('q', quality), ('fps', fps)) if v}
         self.color_url = f"{base_url}/color.json"
         self.settings_url = f"{base_url}/settings"
         
@@ -139,9 +200,9 @@ class CameraViewer:
         else:
             url += f'?ts={int(time.time() * 1000)}'
             
-        r = requests.get(url, stream=True, timeout=10)
+        r = requests.get(url, timeout=10)
         r.raise_for_status()
-        return Image.open(io.BytesIO(r.content))
+        return decode_raw_frame(r.content)
         
     def fetch_color_info(self):
         try:
@@ -197,27 +258,41 @@ class CameraViewer:
         # Update status
         self.status_label.config(text=f"Image: {pil_image.width}x{pil_image.height} pixels")
         
+    def show_color(self, rgb, name):
+        rgb_text = f"RGB=({rgb[0]},{rgb[1]},{rgb[2]}) Color≈{name}"
+        self.color_label.config(text=f"Center color: {rgb_text}")
+
     def update_color_info(self):
         info = self.fetch_color_info()
         if info:
-            rgb_text = f"RGB=({info['r']},{info['g']},{info['b']}) Color≈{info['name']}"
-            self.color_label.config(text=f"Center color: {rgb_text}")
+            self.root.after(0, self.show_color, (info['r'], info['g'], info['b']), info['name'])
             
+    def telemetry_loop(self):
+        # The center color as the ESP pushes it on /ws, a few times a second
+        while self.running:
+            try:
+                for rec in iter_telemetry(self.base_url, hz=4):
+                    if not self.running:
+                        break
+                    self.root.after(0, self.show_color, [int(v) for v in rec['mean']], rec['name'])
+            except Exception:
+                time.sleep(2)
+
     def preview_loop(self):
+        # Frames come from the MJPEG stream as fast as the ESP sends them;
+        # without /ws telemetry the center color is polled about once a second
         while self.running:
             try:
-                params = {'ts': int(time.time() * 1000)}
-                if self.pixel_format.get() >= 0:
-                    params['fmt'] = self.pixel_format.get()
-                    
-                img = self.fetch_image(params)
-                self.root.after(0, self.update_image_display, img)
-                self.root.after(0, self.update_color_info)
-                
-                time.sleep(1)  # 1 FPS for VGA images
-                
+                last_color = 0.0
+                for img in iter_mjpeg(self.stream_url, self.stream_params):
+                    if not self.running:
+                        break
+                    self.root.after(0, self.update_image_display, img)
+                    if websocket is None and time.time() - last_color > 1.0:
+                        last_color = time.time()
+                        threading.Thread(target=self.update_color_info, daemon=True).start()
             except Exception as e:
-                self.root.after(0, lambda: self.status_label.config(text=f"Error: {e}"))
+                self.root.after(0, lambda e=e: self.status_label.config(text=f"Error: {e}"))
                 time.sleep(2)
                 
     def start_preview(self):
@@ -227,6 +302,8 @@ class CameraViewer:
             self.stop_btn.config(state='normal')
             self.preview_thread = threading.Thread(target=self.preview_loop, daemon=True)
             self.preview_thread.start()
+            if websocket is not None:
+                threading.Thread(target=self.telemetry_loop, daemon=True).start()
             
     def stop_preview(self):
         self.running = False
@@ -276,25 +353,36 @@ class CameraViewer:
 
 
 def fetch_image_simple(url, timeout=10):
-    r = requests.get(url, stream=True, timeout=timeout)
+    r = requests.get(url, timeout=timeout)
     r.raise_for_status()
-    data = r.content
-    return Image.open(io.BytesIO(data))
+    if url.split('?')[0].endswith('.raw'):
+        return decode_raw_frame(r.content)
+    return Image.open(io.BytesIO(r.content))
 
 
 def main():
     p = argparse.ArgumentParser(description='ESP32 Camera Viewer with Live Preview')
-    p.add_argument('--url', '-u', default='http://192.168.4.1', help='Base URL (without /frame.ppm)')
+    p.add_argument('--url', '-u', default='http://192.168.4.1', help='Base URL (without /frame.raw)')
+    p.add_argument('--ppm', action='store_true', help='Fetch /frame.ppm (converted on the device) instead of /frame.raw')
+    p.add_argument('--scale', type=int, choices=range(2, 9), metavar='2..8', help='Fetch /preview downscaled by this factor (single mode)')
     p.add_argument('--single', action='store_true', help='Single capture mode (no GUI)')
     p.add_argument('--save', '-s', default=None, help='Save image to file (single mode)')
     p.add_argument('--format', '-f', type=int, choices=[0,1,2,3], help='Override format')
     p.add_argument('--settings', help='Camera settings as key=value,key=value')
+    p.add_argument('--stream-port', type=int, default=81, help='Port of the ESP stream server')
+    p.add_argument('--quality', '-q', type=int, help='Stream JPEG quality 1-100 (ESP default 60)')
+    p.add_argument('--fps', type=int, help='Stream frame-rate cap (ESP default 15)')
+    p.add_argument('--telemetry', action='store_true', help='Print the /ws records: seq, ms, name, mean RGB, sd RGB')
+    p.add_argument('--hz', type=int, help='Telemetry rate cap 1-30 (ESP default 10)')
     args = p.parse_args()
 
     if args.single or args.save:
         # Simple single capture mode
-        frame_url = f"{args.url}/frame.ppm"
+        frame_url = f"{args.url}/frame.ppm" if args.ppm else f"{args.url}/frame.raw"
         params = [f'ts={int(time.time() * 1000)}']
+        if args.scale:
+            frame_url = f"{args.url}/preview"
+            params.append(f'scale={args.scale}')
         
         if args.format is not None:
             params.append(f'fmt={args.format}')
@@ -315,6 +403,18 @@ def main():
             print(f'Error: {e}')
             sys.exit(1)
             
+    elif args.telemetry:
+        # Tab-separated, one line per record, for piping into a plotter or file
+        try:
+            for rec in iter_telemetry(args.url, args.hz):
+                values = '\t'.join(f'{v:.1f}' for v in rec['mean'] + rec['sd'])
+                print(f"{rec['seq']}\t{rec['t']}\t{rec['name']}\t{values}", flush=True)
+        except KeyboardInterrupt:
+            pass
+        except Exception as e:
+            print(f'Error: {e}')
+            sys.exit(1)
+
     elif args.settings:
         # Apply settings only
         settings_url = f"{args.url}/settings"
@@ -333,7 +433,7 @@ def main():
     else:
         # GUI mode
         try:
-            viewer = CameraViewer(args.url)
+            viewer = CameraViewer(args.url, args.stream_port, args.quality, args.fps)
             viewer.run()
         except Exception as e:
             print(f"GUI Error: {e}")
@@ -11,9 +11,29 @@ typedef struct
     // depth_mm is the depth in millimeters.
     int16_t depth_mm;
 
+    // depth_interval_ds is the time since the previous depth sample in
+    // tenths of a second, 0 if unknown. The sensor varies it with conditions.
+    uint16_t depth_interval_ds;
+
+    // Battery state when the sample was taken. power_level is the
+    // sensor's energy-saving level, 0 = normal.
+    uint16_t battery_mv;
+    uint8_t soc_pct;
+    uint8_t power_level;
+
     int16_t r;
     int16_t g;
     int16_t b;
+
+    // exposure_age_h is how old the camera's cached exposure and white
+    // balance were when r/g/b were taken, in hours. 0 means they were
+    // refreshed for this sample, 255 means unknown.
+    uint8_t exposure_age_h;
+
+    // absorbance_mau is the calibrated absorbance of the sample against the
+    // sensor's stored white reference for R, G and B, in thousandths of an
+    // absorbance unit. INT16_MIN means the sensor has no white reference.
+    int16_t absorbance_mau[3];
 } data_t;
 
 typedef struct
@@ -41,6 +61,41 @@ typedef struct
     uint64_t timestamp;
 } sensor_start_packet_t;
 
+// Bytes of JPEG in each image_chunk_packet_t; keeps the packet within the
+// 250 byte ESP-NOW v1 payload.
+#define IMAGE_CHUNK_BYTES 200
+
+// A piece of a daily snapshot. Images go after the numeric data and are
+// sent one chunk at a time, each answered by an image_ack_packet_t.
+typedef struct
+{
+    // image_id is the sensor's number for the snapshot.
+    uint16_t image_id;
+
+    // chunk is the index of this chunk, total the number of chunks in the
+    // image.
+    uint16_t chunk;
+    uint16_t total;
+
+    // len is the number of bytes of data used; only the last chunk is short.
+    uint16_t len;
+
+    // timestamp is when the snapshot was taken, 0 if unknown.
+    uint32_t timestamp;
+
+    uint8_t data[IMAGE_CHUNK_BYTES];
+} image_chunk_packet_t;
+
+// Sent by the receiver for every chunk. next is the chunk it needs next,
+// which lets a transfer cut off by the boat leaving resume on a later pass;
+// next == total means the image is complete.
+typedef struct
+{
+    uint16_t image_id;
+    uint16_t next;
+    uint16_t total;
+} image_ack_packet_t;
+
 typedef enum
 {
     BROADCAST_TYPE_NEW_SENSOR = 0,
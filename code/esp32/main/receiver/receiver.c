@@ -68,6 +68,30 @@ static void recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *d, int
 
         break;
 
+    case sizeof(image_chunk_packet_t):
+        image_chunk_packet_t chunk;
+        memcpy(&chunk, d, sizeof(chunk));
+
+        image_ack_packet_t ack = {.image_id = chunk.image_id, .total = chunk.total};
+        bool completed = false;
+        esp_err_t chunk_err = store_image_chunk(recv_info->src_addr, &chunk, &ack.next, &completed);
+        if (chunk_err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to store image chunk %u/%u: %s", chunk.chunk, chunk.total, esp_err_to_name(chunk_err));
+        }
+        else if (completed)
+        {
+            ESP_LOGI(TAG, "Image %u from " MACSTR " complete", chunk.image_id, MAC2STR(recv_info->src_addr));
+        }
+
+        // Answer even on failure so the sensor knows where to carry on
+        if (must_peer(recv_info->src_addr) == ESP_OK)
+        {
+            esp_now_send(recv_info->src_addr, (uint8_t *)&ack, sizeof(ack));
+        }
+
+        break;
+
     case sizeof(broadcast_packet_t):
         broadcast_packet_t broadcast;
         memcpy(&broadcast, d, sizeof(broadcast));
@@ -1,7 +1,10 @@
 #include "esp_now.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
 #include "data.h"
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "display.h"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
@@ -208,6 +211,107 @@ esp_err_t store_packet(uint8_t *address, data_packet_t *packet, bool *received_a
     return ESP_OK;
 }
 
+// The sensor numbers snapshots from what is on its flash, so an id comes
+// round again after its storage is erased; the time taken and the chunk
+// count keep a new picture from landing on an old one's file.
+uint32_t hash_image(uint8_t *address, const image_chunk_packet_t *chunk)
+{
+    uint32_t h = 0;
+
+    h ^= fnv1a_hash(address, sizeof(address[0]) * 6);
+    h ^= fnv1a_hash("img", 3);
+    // One hash over all three, so no two fields can cancel out
+    const struct
+    {
+        uint16_t image_id;
+        uint16_t total;
+        uint32_t timestamp;
+    } image = {chunk->image_id, chunk->total, chunk->timestamp};
+    h ^= fnv1a_hash(&image, sizeof(image));
+
+    return h;
+}
+
+// Images are assembled in a .prt file whose length says how many chunks
+// have arrived, so a transfer resumes after the boat leaves or the
+// receiver restarts. Only the chunk that extends it is written; next is
+// set to the chunk wanted after this one, and completed is set when this
+// chunk finished the image.
+esp_err_t store_image_chunk(uint8_t *address, image_chunk_packet_t *chunk, uint16_t *next, bool *completed)
+{
+    *completed = false;
+
+    if (chunk->len > IMAGE_CHUNK_BYTES || chunk->chunk >= chunk->total)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char image_key[9];
+    snprintf(image_key, sizeof(image_key), "%08" PRIX32, hash_image(address, chunk));
+
+    char part_name[32], jpg_name[32];
+    snprintf(part_name, sizeof(part_name), "%s/%s.prt", MOUNT_POINT, image_key);
+    snprintf(jpg_name, sizeof(jpg_name), "%s/%s.jpg", MOUNT_POINT, image_key);
+
+    struct stat st;
+    if (stat(jpg_name, &st) == 0)
+    {
+        *next = chunk->total;
+        return ESP_OK;
+    }
+
+    uint16_t have = 0;
+    if (stat(part_name, &st) == 0)
+    {
+        have = (uint16_t)(st.st_size / IMAGE_CHUNK_BYTES);
+    }
+    *next = have;
+
+    if (chunk->chunk != have)
+    {
+        return ESP_OK;
+    }
+
+    FILE *f = fopen(part_name, "ab");
+    if (f == NULL)
+    {
+        return ESP_FAIL;
+    }
+
+    size_t written = fwrite(chunk->data, 1, chunk->len, f);
+    fclose(f);
+    if (written != chunk->len)
+    {
+        // Cut back to whole chunks so the length still counts them
+        truncate(part_name, (off_t)have * IMAGE_CHUNK_BYTES);
+        return ESP_FAIL;
+    }
+    have++;
+    *next = have;
+
+    if (have < chunk->total)
+    {
+        return ESP_OK;
+    }
+
+    if (rename(part_name, jpg_name) != 0)
+    {
+        return ESP_FAIL;
+    }
+    *completed = true;
+
+    // Which sensor and when, since the file name is only a hash
+    f = fopen(MOUNT_POINT "/images.csv", "a");
+    if (f != NULL)
+    {
+        fprintf(f, "%s.jpg," MACSTR ",%u,%" PRIu32 "\n",
+                image_key, MAC2STR(address), chunk->image_id, chunk->timestamp);
+        fclose(f);
+    }
+
+    return ESP_OK;
+}
+
 void mac_to_key(const uint8_t mac[6], char out[17]) // 12 + null
 {
     snprintf(out, 17,
@@ -2,4 +2,5 @@
 
 esp_err_t storage_init(void);
 esp_err_t store_packet(uint8_t *address, data_packet_t *packet, bool *received_all);
-esp_err_t store_sensor(uint8_t *address);
\ No newline at end of file
+esp_err_t store_sensor(uint8_t *address);
+esp_err_t store_image_chunk(uint8_t *address, image_chunk_packet_t *chunk, uint16_t *next, bool *completed);
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "adaptive.h"
+#include <math.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+
+static const char *TAG = "ADAPTIVE";
+
+// Depth period limits
+#define PERIOD_MIN_MS     2000
+#define PERIOD_MAX_MS     120000
+#define PERIOD_DEFAULT_MS 10000
+
+// Samples the slope/variance are estimated over
+#define WINDOW 6
+
+// Tighten as soon as either is exceeded...
+#define TIGHTEN_SLOPE_MM_S 5.0f
+#define TIGHTEN_STD_MM     40.0f
+// ...but only relax after RELAX_AFTER calm evaluations below these
+#define RELAX_SLOPE_MM_S   1.0f
+#define RELAX_STD_MM       10.0f
+#define RELAX_AFTER        3
+
+// Samples older than this say nothing about the current trend
+#define STALE_MS (4 * PERIOD_MAX_MS)
+
+typedef struct {
+    int64_t t_ms[WINDOW];
+    int16_t depth_mm[WINDOW];
+    uint8_t count;
+    uint8_t head;      // next slot to write
+    uint8_t calm;      // consecutive calm evaluations
+    uint32_t period_ms;
+} adaptive_state_t;
+
+// Persist across deep sleep
+static RTC_SLOW_ATTR adaptive_state_t s_state;
+
+// Least-squares slope (mm/s) and standard deviation (mm) of the window
+static void window_stats(float *slope, float *std)
+{
+    const int n = s_state.count;
+    const int64_t t0 = s_state.t_ms[(s_state.head + WINDOW - n) % WINDOW];
+    float sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+
+    for (int i = 0; i < n; i++) {
+        int k = (s_state.head + WINDOW - n + i) % WINDOW;
+        float x = (float)(s_state.t_ms[k] - t0) / 1000.0f;
+        float y = (float)s_state.depth_mm[k];
+        sx += x; sy += y; sxx += x * x; sxy += x * y; syy += y * y;
+    }
+
+    float den = n * sxx - sx * sx;
+    *slope = (den > 1e-6f) ? (n * sxy - sx * sy) / den : 0.0f;
+    float var = syy / n - (sy / n) * (sy / n);
+    *std = var > 0 ? sqrtf(var) : 0.0f;
+}
+
+uint32_t adaptive_depth_update(int16_t depth_mm, int64_t now_ms, uint32_t *out_dt_ms)
+{
+    if (s_state.period_ms == 0) s_state.period_ms = PERIOD_DEFAULT_MS;
+
+    uint32_t dt = 0;
+    if (s_state.count > 0) {
+        int64_t last = s_state.t_ms[(s_state.head + WINDOW - 1) % WINDOW];
+        int64_t d = now_ms - last;
+        if (d < 0 || d > STALE_MS) {
+            // Clock jumped or we were off for a while: start the window over
+            s_state.count = 0;
+            s_state.calm = 0;
+        } else {
+            dt = (uint32_t)d;
+        }
+    }
+    if (out_dt_ms) *out_dt_ms = dt;
+
+    s_state.t_ms[s_state.head] = now_ms;
+    s_state.depth_mm[s_state.head] = depth_mm;
+    s_state.head = (s_state.head + 1) % WINDOW;
+    if (s_state.count < WINDOW) s_state.count++;
+
+    if (s_state.count < 3) return s_state.period_ms;
+
+    float slope, std;
+    window_stats(&slope, &std);
+
+    if (fabsf(slope) > TIGHTEN_SLOPE_MM_S || std > TIGHTEN_STD_MM) {
+        s_state.calm = 0;
+        s_state.period_ms /= 2;
+        if (s_state.period_ms < PERIOD_MIN_MS) s_state.period_ms = PERIOD_MIN_MS;
+    } else if (fabsf(slope) < RELAX_SLOPE_MM_S && std < RELAX_STD_MM) {
+        if (++s_state.calm >= RELAX_AFTER) {
+            s_state.calm = 0;
+            s_state.period_ms *= 2;
+            if (s_state.period_ms > PERIOD_MAX_MS) s_state.period_ms = PERIOD_MAX_MS;
+        }
+    } else {
+        s_state.calm = 0;
+    }
+
+    ESP_LOGD(TAG, "slope=%.2f mm/s std=%.1f mm -> period %lu ms", slope, std, (unsigned long)s_state.period_ms);
+    return s_state.period_ms;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+// Feeds a new depth sample taken at now_ms into the adaptive depth policy.
+// Returns the depth sampling period to use from here on, in ms, and writes the
+// time since the previous sample to *out_dt_ms (0 for the first sample).
+uint32_t adaptive_depth_update(int16_t depth_mm, int64_t now_ms, uint32_t *out_dt_ms);
@@ -0,0 +1,84 @@
+#include "battery.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_log.h"
+
+static const char *TAG = "BATTERY";
+
+#define BATT_GPIO      1   // D0, through a 1:2 divider
+#define BATT_DIVIDER   2
+#define BATT_SAMPLES   16
+
+// 1S Li-ion resting voltage vs state of charge
+static const struct {
+    uint16_t mv;
+    uint8_t soc;
+} SOC_CURVE[] = {
+    {3300, 0},  {3500, 5},  {3600, 10}, {3650, 20}, {3700, 30}, {3750, 40},
+    {3800, 50}, {3900, 65}, {4000, 80}, {4100, 90}, {4200, 100},
+};
+#define SOC_CURVE_LEN (sizeof(SOC_CURVE) / sizeof(SOC_CURVE[0]))
+
+static uint8_t soc_from_mv(uint16_t mv)
+{
+    if (mv <= SOC_CURVE[0].mv) return 0;
+    for (size_t i = 1; i < SOC_CURVE_LEN; i++) {
+        if (mv < SOC_CURVE[i].mv) {
+            uint32_t span = SOC_CURVE[i].mv - SOC_CURVE[i - 1].mv;
+            uint32_t into = mv - SOC_CURVE[i - 1].mv;
+            return (uint8_t)(SOC_CURVE[i - 1].soc + (SOC_CURVE[i].soc - SOC_CURVE[i - 1].soc) * into / span);
+        }
+    }
+    return 100;
+}
+
+esp_err_t battery_read(uint16_t *out_mv, uint8_t *out_soc_pct)
+{
+    if (!out_mv || !out_soc_pct) return ESP_ERR_INVALID_ARG;
+
+    adc_unit_t unit;
+    adc_channel_t channel;
+    esp_err_t err = adc_oneshot_io_to_channel(BATT_GPIO, &unit, &channel);
+    if (err != ESP_OK) return err;
+
+    adc_oneshot_unit_handle_t adc;
+    const adc_oneshot_unit_init_cfg_t unit_cfg = {.unit_id = unit};
+    err = adc_oneshot_new_unit(&unit_cfg, &adc);
+    if (err != ESP_OK) return err;
+
+    const adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    adc_cali_handle_t cali = NULL;
+    const adc_cali_curve_fitting_config_t cali_cfg = {
+        .unit_id = unit,
+        .chan = channel,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+
+    err = adc_oneshot_config_channel(adc, channel, &chan_cfg);
+    if (err == ESP_OK) err = adc_cali_create_scheme_curve_fitting(&cali_cfg, &cali);
+
+    int sum_mv = 0;
+    for (int i = 0; err == ESP_OK && i < BATT_SAMPLES; i++) {
+        int raw = 0, mv = 0;
+        err = adc_oneshot_read(adc, channel, &raw);
+        if (err == ESP_OK) err = adc_cali_raw_to_voltage(cali, raw, &mv);
+        sum_mv += mv;
+    }
+
+    if (cali) adc_cali_delete_scheme_curve_fitting(cali);
+    adc_oneshot_del_unit(adc);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Battery read failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    *out_mv = (uint16_t)(sum_mv / BATT_SAMPLES * BATT_DIVIDER);
+    *out_soc_pct = soc_from_mv(*out_mv);
+    ESP_LOGI(TAG, "Battery %u mV (~%u%%)", *out_mv, *out_soc_pct);
+    return ESP_OK;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+// Reads the battery voltage and estimates state of charge from the resting
+// voltage curve. Uses ADC1, so call it before the probe driver starts.
+esp_err_t battery_read(uint16_t *out_mv, uint8_t *out_soc_pct);
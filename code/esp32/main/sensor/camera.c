@@ -1,8 +1,22 @@
 #include "esp_camera.h"
+#include "jpeg_decoder.h"
+#include "img_converters.h"
+#include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <string.h>
 #include <stdint.h>
+#include <sys/time.h>
+
+#include "driver.h"
+#include "camera.h"
+#include "roi_table.h"
+#include "colorimetry.h"
+#include "led.h"
 
 static const char *TAG = "CAMERA";
 
@@ -31,34 +45,154 @@ static const char *TAG = "CAMERA";
 // Many ESP32 camera drivers deliver BGR565; if your reds/blues are swapped, set to 1.
 #define RGB565_IS_BGR 1
 
-// Average a (2R+1)x(2R+1) window around the center
-#define AVG_RADIUS 3
+// The regions averaged are in ROI_TABLE (roi_table.h)
+
+// Frames averaged per color sample. A frame whose ROI mean is further than
+// MAD_REJECT_K median absolute deviations from the median frame (in any
+// channel) is dropped as flicker/noise. MAD_FLOOR_FX stops a near-zero MAD
+// from rejecting frames that differ by less than half a count.
+#define COLOR_FRAMES   5
+#define MAD_REJECT_K   3
+#define MAD_FLOOR_FX   (1u << 15)
+
+// 1 = if no white reference is stored yet, store this wake's color as it.
+// Flash with the blank/white reference in view, let it wake once, then set
+// back to 0.
+#define COLOR_STORE_WHITE 0
+
+// 1 = each frame is a dark/lit pair: one with the illumination LED off, one
+// with it on, at locked exposure. The dark frame is subtracted per region in
+// linear light, leaving only the LED's reflection off the sample. Off until
+// LED_GPIO in led.c is confirmed on the board.
+#define CAMERA_LED 0
+
+// A pair whose brightest channel gains less than this (Q16 linear) in the
+// primary region means the LED isn't lighting the sample; the wake then
+// falls back to ambient frames.
+#define LED_MIN_SIGNAL (COLOR_LIN_ONE / 100)
+
+// 1 = capture YUV422 instead of RGB565. Y, U and V are summed at full 8
+// bits (RGB565 has 5/6/5) and the region mean is converted to RGB once.
+#define CAMERA_YUV 0
+
+// 1 = log frame time and frame-to-frame noise of RGB565 vs YUV422 once
+// the camera is up, before the normal capture
+#define CAMERA_BENCH 0
+#define BENCH_FRAMES 20
+
+// 1 = take a full UXGA JPEG and decode only the MCUs under the regions, so
+// each well gets 25x the sensor pixels of QVGA for about the same RAM.
+// Needs CONFIG_JD_USE_ROM=n; the ROM decoder can't do partial decodes.
+#define CAMERA_JPEG_ROI 0
+#define JPEG_FRAMESIZE  FRAMESIZE_UXGA
+#define JPEG_QUALITY    8
+
+// Daily snapshot: native OV2640 JPEG at this size, or RGB565 QVGA through
+// frame2jpg on sensors without a JPEG encoder. Frames dropped first so
+// AEC/AWB settle after the fresh init.
+#define SNAPSHOT_FRAMESIZE    FRAMESIZE_VGA
+#define SNAPSHOT_SETTLE_FRAMES 8
+
+// ==============================
+// ROI capture: have the sensor output only a small centered window
+// ==============================
+// 1 = program the OV2640 DSP window so each frame is ROI_OUT_PX square
+// (18 KB in DRAM) instead of a full QVGA frame (150 KB in PSRAM).
+#define CAMERA_ROI_CAPTURE 1
+
+// 1 = no frame buffer at all: cam_hal hands DMA blocks to a callback that
+// sums the ROI rows, and capture stops after the last ROI row.
+#define CAMERA_STREAM_CAPTURE 1
+
+// cam_hal sizes its DMA and frame buffers from a framesize_t, and 96x96 is
+// the smallest one it knows.
+#define ROI_FRAMESIZE FRAMESIZE_96X96
+#define ROI_OUT_PX    96
+
+// DSP downscale over the window: 1 = plain crop, 2 or 3 = each output pixel
+// averages a 2x2 or 3x3 block of sensor pixels (better SNR, wider field).
+#define ROI_BIN 1
+
+// In CIF mode the OV2640 window is 400x296 units, QVGA maps 320 px onto 400
+#define OV2640_MODE_CIF   2
+#define CIF_WINDOW_W      400
+#define CIF_WINDOW_H      296
+#define CIF_PER_QVGA_PX   1.25f
+
+#define ROI_WINDOW_PX (ROI_OUT_PX * ROI_BIN)
+_Static_assert(ROI_WINDOW_PX <= CIF_WINDOW_H, "ROI window larger than the sensor window");
+_Static_assert(ROI_WINDOW_PX % 4 == 0, "OV2640 window sizes are multiples of 4");
+
+#if CAMERA_JPEG_ROI && (CAMERA_ROI_CAPTURE || CAMERA_STREAM_CAPTURE || CAMERA_YUV || CAMERA_BENCH)
+#error "CAMERA_JPEG_ROI takes whole JPEG frames; turn off the ROI window, streaming, YUV and the bench"
+#endif
+_Static_assert(ROI_MAX <= ESP_JPEG_MAX_ROIS, "ROI table larger than the JPEG decoder takes");
 
 static bool s_cam_inited = false;
 
-static inline void rgb565_to_rgb888(uint16_t pix, uint8_t *r, uint8_t *g, uint8_t *b)
+// Output pixels per QVGA pixel for the frames we're getting, so the
+// averaging window keeps the same footprint on the scene. Kept with the
+// snapshot since a restored sensor already has its window programmed.
+static RTC_SLOW_ATTR float s_px_per_qvga = 1.0f;
+
+// Sensor registers after the first full init, replayed on later wakes
+// instead of probing and uploading the register tables again
+static RTC_SLOW_ATTR camera_snapshot_t s_snapshot;
+
+// camera_init() time with the full init, for comparison in the logs
+static RTC_SLOW_ATTR int64_t s_full_init_us = 0;
+static bool s_from_snapshot = false;
+
+#if CAMERA_STREAM_CAPTURE
+static bool skip_frame_cb(const camera_stream_block_t *blk, void *arg)
+{
+    (void)blk;
+    (void)arg;
+    return false;
+}
+#endif
+
+#if CAMERA_ROI_CAPTURE
+
+static esp_err_t set_roi_window(void)
 {
-    // unpack 5-6-5
-    uint8_t R = (uint8_t)(((pix >> 11) & 0x1F) * 255 / 31);
-    uint8_t G = (uint8_t)(((pix >> 5)  & 0x3F) * 255 / 63);
-    uint8_t B = (uint8_t)(( pix        & 0x1F) * 255 / 31);
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s) return ESP_ERR_INVALID_STATE;
+
+    // Until the window is programmed we get the whole field scaled to 96x96
+    s_px_per_qvga = (float)ROI_OUT_PX / 320.0f;
+
+    // set_res_raw() arguments are sensor specific; only the OV2640 layout is known here
+    if (s->id.PID != OV2640_PID || !s->set_res_raw) {
+        ESP_LOGW(TAG, "No ROI window for sensor PID 0x%02x, using full field", s->id.PID);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const int off_x = (CIF_WINDOW_W - ROI_WINDOW_PX) / 2;
+    const int off_y = (CIF_WINDOW_H - ROI_WINDOW_PX) / 2;
+    if (s->set_res_raw(s, OV2640_MODE_CIF, 0, 0, 0, off_x, off_y,
+                       ROI_WINDOW_PX, ROI_WINDOW_PX, ROI_OUT_PX, ROI_OUT_PX,
+                       ROI_BIN > 1, ROI_BIN > 1) != 0) {
+        ESP_LOGW(TAG, "set_res_raw failed, using full field");
+        return ESP_FAIL;
+    }
 
-#if RGB565_IS_BGR
-    // swap R/B
-    *r = B;
-    *g = G;
-    *b = R;
+    // The frame in flight was started with the old window
+#if CAMERA_STREAM_CAPTURE
+    esp_camera_stream(skip_frame_cb, NULL, 0, 1000);
 #else
-    *r = R;
-    *g = G;
-    *b = B;
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb) esp_camera_fb_return(fb);
 #endif
+
+    s_px_per_qvga = CIF_PER_QVGA_PX / ROI_BIN;
+    ESP_LOGI(TAG, "ROI window %dx%d at (%d,%d), bin %d", ROI_WINDOW_PX, ROI_WINDOW_PX, off_x, off_y, ROI_BIN);
+    return ESP_OK;
 }
+#endif
 
-esp_err_t camera_init(void)
+static void camera_config_pins(camera_config_t *out)
 {
-    if (s_cam_inited) return ESP_OK;
-
     camera_config_t config = {0};
     config.ledc_channel = LEDC_CHANNEL_0;
     config.ledc_timer   = LEDC_TIMER_0;
@@ -84,95 +218,990 @@ esp_err_t camera_init(void)
     config.pin_reset    = RESET_GPIO_NUM;
 
     config.xclk_freq_hz = 20000000;
+    *out = config;
+}
+
+esp_err_t camera_init(void)
+{
+    if (s_cam_inited) return ESP_OK;
+
+    camera_config_t config;
+    camera_config_pins(&config);
 
     // We want color metrics, so RGB565 is fine
-    config.pixel_format = PIXFORMAT_RGB565;
+    config.pixel_format = CAMERA_JPEG_ROI ? PIXFORMAT_JPEG : CAMERA_YUV ? PIXFORMAT_YUV422 : PIXFORMAT_RGB565;
 
+#if CAMERA_ROI_CAPTURE
+    config.frame_size   = ROI_FRAMESIZE;
+    // Two buffers so the next frame is captured while this one is reduced
+    config.fb_count     = CAMERA_STREAM_CAPTURE ? 0 : 2;
+    config.grab_mode    = CAMERA_GRAB_LATEST;
+    config.fb_location  = CAMERA_FB_IN_DRAM;
+#elif CAMERA_JPEG_ROI
+    config.frame_size   = JPEG_FRAMESIZE;
+    config.jpeg_quality = JPEG_QUALITY;
+    config.fb_count     = 2;
+    config.grab_mode    = CAMERA_GRAB_LATEST;
+    config.fb_location  = CAMERA_FB_IN_PSRAM;
+#else
     // Keep it modest for speed/memory. Color from center doesn’t need VGA.
     config.frame_size   = FRAMESIZE_QVGA; // 320x240
-    config.fb_count     = 1;
+    config.fb_count     = 2;
     config.grab_mode    = CAMERA_GRAB_LATEST;
 
     // Use PSRAM if present; if your board doesn’t have PSRAM, you may need CAMERA_FB_IN_DRAM
     config.fb_location  = CAMERA_FB_IN_PSRAM;
+#endif
+
+    s_from_snapshot = false;
+    if (esp_camera_snapshot_valid(&s_snapshot)) {
+        esp_err_t err = esp_camera_init_from_snapshot(&config, &s_snapshot);
+        if (err == ESP_OK) {
+            s_cam_inited = true;
+            s_from_snapshot = true;
+            ESP_LOGI(TAG, "Camera restored from snapshot");
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Snapshot restore failed (%s), doing a full init", esp_err_to_name(err));
+        s_snapshot.magic = 0;
+    }
 
     ESP_LOGI(TAG, "Initializing camera...");
+    esp_camera_snapshot_record(&s_snapshot);
     esp_err_t err = esp_camera_init(&config);
     if (err != ESP_OK) {
+        esp_camera_snapshot_finish();
+        s_snapshot.magic = 0;
         ESP_LOGE(TAG, "esp_camera_init failed: %s", esp_err_to_name(err));
         return err;
     }
 
     s_cam_inited = true;
     ESP_LOGI(TAG, "Camera initialized");
+
+#if CAMERA_ROI_CAPTURE
+    set_roi_window();
+#elif CAMERA_JPEG_ROI
+    s_px_per_qvga = (float)resolution[JPEG_FRAMESIZE].width / 320.0f;
+#else
+    s_px_per_qvga = 1.0f;
+#endif
+
+    err = esp_camera_snapshot_finish();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No register snapshot: %s", esp_err_to_name(err));
+    }
     return ESP_OK;
 }
 
-esp_err_t camera_capture_color(uint8_t *out_r, uint8_t *out_g, uint8_t *out_b)
+
+// Per frame: 16.16 means of the primary sample, which the outlier test
+// looks at, and the linear-light (Q16) mean of every region
+typedef struct {
+    uint32_t mean_fx[3];
+    uint32_t lin_fx[ROI_MAX][3];
+    uint16_t valid;     // bit i = region i was inside the frame
+} roi_frame_t;
+
+static roi_multi_t s_rois;
+static roi_frame_t s_frames[CAMERA_MAX_FRAMES];
+
+// Set while a lit frame is streaming; the callback turns the LED off as soon
+// as the last region row is in
+static volatile bool s_led_gate = false;
+
+static inline void led_gate_end(void)
 {
-    if (!out_r || !out_g || !out_b) return ESP_ERR_INVALID_ARG;
+    if (s_led_gate) {
+        s_led_gate = false;
+        led_set(false);
+    }
+}
+
+#if CAMERA_STREAM_CAPTURE
+// Runs in the camera task for each DMA block; blocks always hold whole rows
+static bool roi_stream_cb(const camera_stream_block_t *blk, void *arg)
+{
+    roi_multi_t *m = (roi_multi_t *)arg;
+    const size_t stride = (size_t)blk->width * 2;
+
+    for (int i = 0; i < blk->rows; i++) {
+        int y = blk->row + i;
+        if (y < m->first_row) continue;
+        if (y > m->last_row) {
+            led_gate_end();
+            return false;
+        }
+        roi_multi_add_row(m, y, blk->data + (size_t)i * stride);
+    }
+    if (blk->row + blk->rows <= m->last_row) return true;
+    led_gate_end();
+    return false;
+}
+#endif
+
+#define ROI_FLAGS_BAD 0xFFFFFFFFu
+
+static uint32_t roi_flags(pixformat_t fmt)
+{
+    if (fmt == PIXFORMAT_RGB565) return RGB565_IS_BGR ? ROI_STATS_BGR : 0;
+    if (fmt == PIXFORMAT_YUV422) return ROI_STATS_YUV422;
+    return ROI_FLAGS_BAD;
+}
+
+// BT.601 studio range, as conversions/yuv.c; Q12 coefficients
+#define YUV_Y  4768   // 1.164
+#define YUV_RV 6537   // 1.596
+#define YUV_GU 1605   // 0.392
+#define YUV_GV 3330   // 0.813
+#define YUV_BU 8263   // 2.017
 
+// Mean Y/U/V (16.16) to RGB (16.16, 0..255)
+static void yuv_to_rgb_fx(const int64_t yuv[3], uint32_t rgb[3])
+{
+    const int64_t y = (yuv[0] - (16 << 16)) * YUV_Y;
+    const int64_t u = yuv[1] - (128 << 16);
+    const int64_t v = yuv[2] - (128 << 16);
+    const int64_t out[3] = {
+        y + YUV_RV * v,
+        y - YUV_GU * u - YUV_GV * v,
+        y + YUV_BU * u,
+    };
+    for (int c = 0; c < 3; c++) {
+        int64_t q = out[c] / 4096;
+        rgb[c] = (q < 0) ? 0 : (q > (255 << 16)) ? (255u << 16) : (uint32_t)q;
+    }
+}
+
+// The YUV path converts each region's mean once; averaging happens before
+// linearisation here, which is close enough over a small uniform region
+static esp_err_t finish_yuv_frame(const roi_multi_t *m, int primary, roi_frame_t *f)
+{
+    f->valid = 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        const roi_yuv_acc_t *a = &m->yuv_acc[i];
+        if (a->count == 0) {
+            memset(f->lin_fx[i], 0, sizeof(f->lin_fx[i]));
+            continue;
+        }
+
+        int64_t yuv[3];
+        uint32_t rgb[3];
+        for (int c = 0; c < 3; c++) yuv[c] = (int64_t)(((uint64_t)a->sum[c] << 16) / a->count);
+        yuv_to_rgb_fx(yuv, rgb);
+        colorimetry_decode(rgb, f->lin_fx[i]);
+        if (i == primary) memcpy(f->mean_fx, rgb, sizeof(f->mean_fx));
+        f->valid |= (uint16_t)(1u << i);
+    }
+    return (f->valid & (1u << primary)) ? ESP_OK : ESP_FAIL;
+}
+
+#if CAMERA_JPEG_ROI
+// Region sums over the decoded MCUs. Pixels are 8-bit sRGB, so each value
+// indexes the linearisation LUT directly.
+typedef struct {
+    const roi_multi_t *m;
+    const uint16_t *lut;
+    uint32_t count[ROI_MAX];
+    uint32_t sum[ROI_MAX][3];
+    uint64_t lin[ROI_MAX][3];
+} jpeg_roi_acc_t;
+
+static bool jpeg_block_cb(void *arg, const uint8_t *pixels, const esp_jpeg_rect_t *rect)
+{
+    jpeg_roi_acc_t *a = (jpeg_roi_acc_t *)arg;
+    const int bw = rect->right - rect->left + 1;
+
+    for (int i = 0; i < ROI_COUNT; i++) {
+        if (!roi_multi_valid(a->m, i)) continue;
+        const roi_span_t *s = &a->m->span[i];
+        const int x0 = (s->x0 > rect->left) ? s->x0 : rect->left;
+        const int x1 = (s->x1 < rect->right) ? s->x1 : rect->right;
+        const int y0 = (s->y0 > rect->top) ? s->y0 : rect->top;
+        const int y1 = (s->y1 < rect->bottom) ? s->y1 : rect->bottom;
+        if (x0 > x1 || y0 > y1) continue;
+
+        for (int y = y0; y <= y1; y++) {
+            const uint8_t *p = pixels + ((size_t)(y - rect->top) * bw + (x0 - rect->left)) * 3;
+            for (int x = x0; x <= x1; x++, p += 3) {
+                for (int c = 0; c < 3; c++) {
+                    a->sum[i][c] += p[c];
+                    a->lin[i][c] += a->lut[p[c]];
+                }
+            }
+        }
+        a->count[i] += (uint32_t)((x1 - x0 + 1) * (y1 - y0 + 1));
+    }
+    return true;
+}
+
+// Only the MCUs under a region are dequantised, transformed and converted
+static esp_err_t decode_jpeg_rois(const camera_fb_t *fb, int primary, roi_frame_t *f)
+{
+    static jpeg_roi_acc_t acc;
+    roi_multi_t *m = &s_rois;
+
+    roi_multi_begin(m, fb->width, fb->height, s_px_per_qvga, 0);
+    if (!roi_multi_valid(m, primary)) return ESP_FAIL;
+
+    esp_jpeg_rect_t rects[ROI_MAX];
+    size_t n = 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        if (!roi_multi_valid(m, i)) continue;
+        rects[n].left = (uint16_t)m->span[i].x0;
+        rects[n].right = (uint16_t)m->span[i].x1;
+        rects[n].top = (uint16_t)m->span[i].y0;
+        rects[n].bottom = (uint16_t)m->span[i].y1;
+        n++;
+    }
+
+    memset(&acc, 0, sizeof(acc));
+    acc.m = m;
+    acc.lut = colorimetry_lut();
+
+    esp_jpeg_image_cfg_t cfg = {
+        .indata = fb->buf,
+        .indata_size = fb->len,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_err_t err = esp_jpeg_decode_rois(&cfg, rects, n, jpeg_block_cb, &acc, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "JPEG ROI decode failed: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+
+    f->valid = 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        if (acc.count[i] == 0) {
+            memset(f->lin_fx[i], 0, sizeof(f->lin_fx[i]));
+            continue;
+        }
+        for (int c = 0; c < 3; c++) {
+            f->lin_fx[i][c] = (uint32_t)(acc.lin[i][c] / acc.count[i]);
+            if (i == primary) f->mean_fx[c] = (uint32_t)(((uint64_t)acc.sum[i][c] << 16) / acc.count[i]);
+        }
+        f->valid |= (uint16_t)(1u << i);
+    }
+    return (f->valid & (1u << primary)) ? ESP_OK : ESP_FAIL;
+}
+#endif
+
+// All regions of one frame in a single pass over its rows
+static esp_err_t capture_roi_frame(roi_frame_t *f)
+{
+    roi_multi_t *m = &s_rois;
+    const int primary = roi_primary();
+    if (primary < 0) return ESP_ERR_INVALID_STATE;
+
+#if CAMERA_STREAM_CAPTURE
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s) return ESP_ERR_INVALID_STATE;
+    const uint32_t flags = roi_flags(s->pixformat);
+    if (flags == ROI_FLAGS_BAD) {
+        ESP_LOGW(TAG, "Unexpected format: %d", s->pixformat);
+        return ESP_FAIL;
+    }
+
+    // No frame buffer: rows are summed as they arrive and DMA stops after the last region
+    const resolution_info_t *res = &resolution[s->status.framesize];
+    roi_multi_begin(m, res->width, res->height, s_px_per_qvga, flags);
+    if (!roi_multi_valid(m, primary)) return ESP_FAIL;
+    esp_err_t err = esp_camera_stream(roi_stream_cb, m, (uint16_t)m->last_row, 1000);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Streamed capture failed: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+#else
     camera_fb_t *fb = esp_camera_fb_get();
     if (!fb) {
         ESP_LOGW(TAG, "Failed to get frame buffer");
         return ESP_FAIL;
     }
 
-    if (fb->format != PIXFORMAT_RGB565) {
+#if CAMERA_JPEG_ROI
+    if (fb->format == PIXFORMAT_JPEG) {
+        esp_err_t err = decode_jpeg_rois(fb, primary, f);
+        esp_camera_fb_return(fb);
+        return err;
+    }
+#endif
+
+    const uint32_t flags = roi_flags(fb->format);
+    if (flags == ROI_FLAGS_BAD) {
         ESP_LOGW(TAG, "Unexpected format: %d", fb->format);
         esp_camera_fb_return(fb);
         return ESP_FAIL;
     }
 
-    const uint16_t w = fb->width;
-    const uint16_t h = fb->height;
-    const uint16_t cx = w / 2;
-    const uint16_t cy = h / 2;
+    // The driver is already filling the other buffer while this one is summed
+    // Compute stride bytes (some drivers pad rows)
+    size_t stride_bytes = (fb->height > 0) ? (fb->len / fb->height) : (size_t)fb->width * 2;
+    if (stride_bytes < (size_t)fb->width * 2) stride_bytes = (size_t)fb->width * 2;
 
-    // Frame buffer is bytes; interpret pixels carefully
-    const uint8_t *buf8 = (const uint8_t *)fb->buf;
+    roi_multi_begin(m, fb->width, fb->height, s_px_per_qvga, flags);
+    for (int y = m->first_row; y <= m->last_row; y++) {
+        if ((size_t)(y + 1) * stride_bytes > fb->len) break;
+        roi_multi_add_row(m, y, fb->buf + (size_t)y * stride_bytes);
+    }
 
-    // Compute stride bytes (some drivers pad rows)
-    size_t stride_bytes = (fb->height > 0) ? (fb->len / fb->height) : (size_t)w * 2;
-    if (stride_bytes < (size_t)w * 2) stride_bytes = (size_t)w * 2;
+    esp_camera_fb_return(fb);
+#endif
+
+    if (m->yuv) return finish_yuv_frame(m, primary, f);
+
+    const uint16_t *lut = colorimetry_lut();
+    f->valid = 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        roi_stats_t st;
+        roi_stats_end(&m->stats[i], false, &st);
+        if (st.count == 0) {
+            memset(f->lin_fx[i], 0, sizeof(f->lin_fx[i]));
+            continue;
+        }
+
+        // Linearised per code before averaging, so no per-pixel work is added
+        uint64_t lin[3];
+        roi_stats_lut_sum(&m->stats[i], lut, lin);
+        for (int c = 0; c < 3; c++) {
+            f->lin_fx[i][c] = (uint32_t)(lin[c] / st.count);
+            if (i == primary) f->mean_fx[c] = (uint32_t)(((uint64_t)st.sum[c] << 16) / st.count);
+        }
+        f->valid |= (uint16_t)(1u << i);
+    }
+    return (f->valid & (1u << primary)) ? ESP_OK : ESP_FAIL;
+}
+
+#if CAMERA_LED || CAMERA_BENCH
+// Waits out the frame in flight, so the next one is exposed entirely under
+// the current lighting
+static void skip_frame(void)
+{
+#if CAMERA_STREAM_CAPTURE
+    esp_camera_stream(skip_frame_cb, NULL, 0, 1000);
+#else
+    for (int i = 0; i < 2; i++) {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb) esp_camera_fb_return(fb);
+    }
+#endif
+}
+#endif
+
+#if CAMERA_LED
+// Set once led_init() works; cleared for the rest of the wake if the LED
+// turns out not to light the sample
+static bool s_led_ok = false;
+
+static inline uint32_t sat_sub(uint32_t a, uint32_t b)
+{
+    return (a > b) ? a - b : 0;
+}
 
-    uint32_t sumR = 0, sumG = 0, sumB = 0;
-    uint32_t count = 0;
+// One ambient-rejected frame: dark, then lit, subtracted per region.
+// ESP_ERR_INVALID_RESPONSE if the LED adds less than LED_MIN_SIGNAL.
+static esp_err_t capture_led_frame(roi_frame_t *f)
+{
+    static roi_frame_t dark;
+    static bool lit_before = false;
 
-    const int R = AVG_RADIUS;
-    for (int dy = -R; dy <= R; dy++) {
-        int y = (int)cy + dy;
-        if (y < 0 || y >= (int)h) continue;
+    // Rows of the frame after a lit one may have started integrating with
+    // the LED still on
+    if (lit_before) skip_frame();
+    esp_err_t err = capture_roi_frame(&dark);
+    if (err != ESP_OK) return err;
 
-        size_t row_off = (size_t)y * stride_bytes;
-        for (int dx = -R; dx <= R; dx++) {
-            int x = (int)cx + dx;
-            if (x < 0 || x >= (int)w) continue;
+    // A row integrates for up to a frame before it's read out, so the LED
+    // goes on a frame ahead and stays on only until the last region row
+    led_set(true);
+    skip_frame();
+    s_led_gate = true;
+    err = capture_roi_frame(f);
+    s_led_gate = false;
+    led_set(false);
+    lit_before = true;
+    if (err != ESP_OK) return err;
 
-            size_t pix_off = row_off + (size_t)x * 2;
-            if (pix_off + 1 >= fb->len) continue;
+    const int primary = roi_primary();
+    uint32_t signal = 0;
+    for (int c = 0; c < 3; c++) {
+        const uint32_t d = sat_sub(f->lin_fx[primary][c], dark.lin_fx[primary][c]);
+        if (d > signal) signal = d;
+    }
+    if (signal < LED_MIN_SIGNAL) return ESP_ERR_INVALID_RESPONSE;
 
-            // little-endian 16-bit
-            uint16_t pix = (uint16_t)buf8[pix_off] | ((uint16_t)buf8[pix_off + 1] << 8);
+    f->valid &= dark.valid;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        for (int c = 0; c < 3; c++) f->lin_fx[i][c] = sat_sub(f->lin_fx[i][c], dark.lin_fx[i][c]);
+    }
+    // r/g/b and the outlier test see the difference, re-encoded
+    colorimetry_encode(f->lin_fx[primary], f->mean_fx);
+    return ESP_OK;
+}
+#endif
 
-            uint8_t r,g,b;
-            rgb565_to_rgb888(pix, &r, &g, &b);
+#if CAMERA_BENCH
+static void bench_format(sensor_t *s, pixformat_t fmt, const char *name)
+{
+    if (s->set_pixformat(s, fmt) != 0) {
+        ESP_LOGW(TAG, "Bench: can't switch to %s", name);
+        return;
+    }
+    skip_frame();
 
-            sumR += r; sumG += g; sumB += b;
-            count++;
+    static roi_frame_t f;
+    double sum[3] = {0}, sumsq[3] = {0};
+    int64_t busy_us = 0;
+    int n = 0;
+    for (int k = 0; k < BENCH_FRAMES; k++) {
+        const int64_t t0 = esp_timer_get_time();
+        esp_err_t err = capture_roi_frame(&f);
+        busy_us += esp_timer_get_time() - t0;
+        if (err != ESP_OK) continue;
+        for (int c = 0; c < 3; c++) {
+            double v = (double)f.mean_fx[c] / 65536.0;
+            sum[c] += v;
+            sumsq[c] += v * v;
         }
+        n++;
+    }
+    if (n < 2) {
+        ESP_LOGW(TAG, "Bench: %s gave %d frames", name, n);
+        return;
     }
 
-    esp_camera_fb_return(fb);
+    double sd[3];
+    for (int c = 0; c < 3; c++) {
+        double m = sum[c] / n;
+        double var = (sumsq[c] - n * m * m) / (n - 1);
+        sd[c] = var > 0 ? sqrt(var) : 0;
+    }
+    ESP_LOGI(TAG, "Bench %s: %.1f ms/frame, mean %.1f/%.1f/%.1f, sd %.3f/%.3f/%.3f counts (%d frames)",
+             name, busy_us / 1000.0 / BENCH_FRAMES, sum[0] / n, sum[1] / n, sum[2] / n, sd[0], sd[1], sd[2], n);
+}
+
+// Same scene, same exposure, both formats back to back
+static void camera_bench(void)
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s || !s->set_pixformat) return;
+    const pixformat_t orig = s->pixformat;
+
+    s->set_exposure_ctrl(s, 0);
+    s->set_gain_ctrl(s, 0);
+    s->set_whitebal(s, 0);
+    bench_format(s, PIXFORMAT_RGB565, "RGB565");
+    bench_format(s, PIXFORMAT_YUV422, "YUV422");
 
-    if (count == 0) {
-        *out_r = *out_g = *out_b = 0;
+    s->set_pixformat(s, orig);
+    skip_frame();
+}
+#endif
+
+static uint32_t median_fx(uint32_t *v, int n)
+{
+    for (int i = 1; i < n; i++) {
+        uint32_t k = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > k) { v[j + 1] = v[j]; j--; }
+        v[j + 1] = k;
+    }
+    return (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static inline uint32_t abs_diff(uint32_t a, uint32_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+static inline uint8_t fx_to_u8(uint32_t fx)
+{
+    uint32_t v = (fx + (1u << 15)) >> 16;
+    return (v > 255) ? 255 : (uint8_t)v;
+}
+
+esp_err_t camera_capture_color_avg(int frames, camera_color_t *out)
+{
+    if (!out || frames < 1 || frames > CAMERA_MAX_FRAMES) return ESP_ERR_INVALID_ARG;
+
+    roi_frame_t *f = s_frames;
+    int n = 0;
+    for (int k = 0; k < frames; k++) {
+#if CAMERA_LED
+        if (s_led_ok) {
+            const esp_err_t err = capture_led_frame(&f[n]);
+            if (err == ESP_OK) n++;
+            if (err != ESP_ERR_INVALID_RESPONSE) continue;
+            // Lit minus dark would be ~0: start over on ambient frames
+            ESP_LOGW(TAG, "LED adds no light to the sample, measuring ambient");
+            s_led_ok = false;
+            n = 0;
+            k = -1;
+            continue;
+        }
+#endif
+        if (capture_roi_frame(&f[n]) == ESP_OK) n++;
+    }
+    if (n == 0) {
+        memset(out, 0, sizeof(*out));
         return ESP_FAIL;
     }
 
-    *out_r = (uint8_t)(sumR / count);
-    *out_g = (uint8_t)(sumG / count);
-    *out_b = (uint8_t)(sumB / count);
+    // Median and MAD of the frame means, per channel
+    uint32_t med[3], mad[3], tmp[CAMERA_MAX_FRAMES];
+    for (int c = 0; c < 3; c++) {
+        for (int k = 0; k < n; k++) tmp[k] = f[k].mean_fx[c];
+        med[c] = median_fx(tmp, n);
+        for (int k = 0; k < n; k++) tmp[k] = abs_diff(f[k].mean_fx[c], med[c]);
+        mad[c] = median_fx(tmp, n);
+        if (mad[c] < MAD_FLOOR_FX) mad[c] = MAD_FLOOR_FX;
+    }
+
+    uint64_t sum[3] = {0};
+    uint64_t lin_sum[ROI_MAX][3] = {{0}};
+    uint16_t valid = 0xFFFF;
+    bool keep[CAMERA_MAX_FRAMES];
+    int used = 0;
+    for (int k = 0; k < n; k++) {
+        keep[k] = true;
+        for (int c = 0; c < 3; c++) {
+            if (abs_diff(f[k].mean_fx[c], med[c]) > MAD_REJECT_K * mad[c]) keep[k] = false;
+        }
+        if (!keep[k]) continue;
+        for (int c = 0; c < 3; c++) sum[c] += f[k].mean_fx[c];
+        for (int i = 0; i < ROI_COUNT; i++) {
+            for (int c = 0; c < 3; c++) lin_sum[i][c] += f[k].lin_fx[i][c];
+        }
+        valid &= f[k].valid;
+        used++;
+    }
+
+    // The median frame always survives, so used >= 1
+    uint32_t mean[3];
+    uint64_t var[3] = {0};
+    for (int c = 0; c < 3; c++) mean[c] = (uint32_t)(sum[c] / used);
+    for (int k = 0; k < n; k++) {
+        if (!keep[k]) continue;
+        for (int c = 0; c < 3; c++) {
+            int64_t d = (int64_t)f[k].mean_fx[c] - (int64_t)mean[c];
+            var[c] += (uint64_t)(d * d) >> 16;
+        }
+    }
+
+    out->r = fx_to_u8(mean[0]);
+    out->g = fx_to_u8(mean[1]);
+    out->b = fx_to_u8(mean[2]);
+    for (int c = 0; c < 3; c++) {
+        out->mean_fx[c] = mean[c];
+        // Sample variance over the kept frames; sqrt(16.16) * 256 is back in 16.16
+        out->sd_fx[c] = (used > 1) ? (uint32_t)lroundf(sqrtf((float)(var[c] / (uint64_t)(used - 1))) * 256.0f) : 0;
+    }
+    for (int i = 0; i < ROI_COUNT; i++) {
+        for (int c = 0; c < 3; c++) out->roi_lin_fx[i][c] = (uint32_t)(lin_sum[i][c] / used);
+    }
+    memcpy(out->lin_fx, out->roi_lin_fx[roi_primary()], sizeof(out->lin_fx));
+    out->roi_valid = valid & (uint16_t)((1u << ROI_COUNT) - 1);
+    out->frames = (uint8_t)used;
+    out->rejected = (uint8_t)(n - used);
 
+    if (out->rejected) {
+        ESP_LOGI(TAG, "Dropped %d of %d frames as outliers", out->rejected, n);
+    }
     return ESP_OK;
 }
+
+esp_err_t camera_capture_color(uint8_t *out_r, uint8_t *out_g, uint8_t *out_b)
+{
+    if (!out_r || !out_g || !out_b) return ESP_ERR_INVALID_ARG;
+
+    camera_color_t c;
+    esp_err_t err = camera_capture_color_avg(1, &c);
+    *out_r = c.r;
+    *out_g = c.g;
+    *out_b = c.b;
+    return err;
+}
+
+// The color capture's window, format and buffers don't suit a picture, so
+// the driver is brought up again from scratch and shut down afterwards
+static esp_err_t snapshot_init(pixformat_t fmt, framesize_t size, int native_q)
+{
+    if (s_cam_inited) {
+        esp_camera_deinit();
+        s_cam_inited = false;
+    }
+
+    camera_config_t config;
+    camera_config_pins(&config);
+    config.pixel_format = fmt;
+    config.frame_size   = size;
+    config.jpeg_quality = native_q;
+    config.fb_count     = 1;
+    config.grab_mode    = CAMERA_GRAB_WHEN_EMPTY;
+    config.fb_location  = CAMERA_FB_IN_PSRAM;
+
+    esp_err_t err = esp_camera_init(&config);
+    if (err != ESP_OK) return err;
+    s_cam_inited = true;
+
+    for (int i = 0; i < SNAPSHOT_SETTLE_FRAMES; i++) {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb) esp_camera_fb_return(fb);
+    }
+    return ESP_OK;
+}
+
+typedef struct {
+    camera_jpeg_sink_t sink;
+    void *arg;
+    esp_err_t err;
+} jpeg_sink_ctx_t;
+
+static size_t jpeg_sink_cb(void *arg, size_t index, const void *data, size_t len)
+{
+    (void)index;
+    jpeg_sink_ctx_t *ctx = (jpeg_sink_ctx_t *)arg;
+    if (ctx->err == ESP_OK) ctx->err = ctx->sink(data, len, ctx->arg);
+    return (ctx->err == ESP_OK) ? len : 0;
+}
+
+esp_err_t camera_capture_jpeg(uint8_t quality, camera_jpeg_sink_t sink, void *arg)
+{
+    if (!sink || quality < 1 || quality > 100) return ESP_ERR_INVALID_ARG;
+
+    // OV2640 quality runs the other way: 0..63, lower is better
+    const int native_q = 2 + (100 - quality) * 61 / 100;
+    bool native = true;
+    esp_err_t err = snapshot_init(PIXFORMAT_JPEG, SNAPSHOT_FRAMESIZE, native_q);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No native JPEG (%s), encoding RGB565", esp_err_to_name(err));
+        native = false;
+        err = snapshot_init(PIXFORMAT_RGB565, FRAMESIZE_QVGA, 0);
+    }
+    if (err != ESP_OK) return err;
+
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+        err = ESP_FAIL;
+    } else if (native && fb->format == PIXFORMAT_JPEG) {
+        err = sink(fb->buf, fb->len, arg);
+    } else {
+        jpeg_sink_ctx_t ctx = {.sink = sink, .arg = arg, .err = ESP_OK};
+        err = frame2jpg_cb(fb, quality, jpeg_sink_cb, &ctx) ? ESP_OK : (ctx.err != ESP_OK ? ctx.err : ESP_FAIL);
+    }
+    if (fb) {
+        ESP_LOGI(TAG, "Snapshot %ux%u %s: %s", fb->width, fb->height, native ? "native JPEG" : "frame2jpg",
+                 esp_err_to_name(err));
+        esp_camera_fb_return(fb);
+    }
+
+    esp_camera_deinit();
+    s_cam_inited = false;
+    return err;
+}
+
+
+// ==============================
+// Exposure/white-balance cache
+// ==============================
+// Auto exposure and white balance need a second or so of frames to settle
+// after power-up. Once they have, the converged values are saved and the
+// following wakes apply them by hand with the auto loops off, so the first
+// frame is already usable.
+#define EXPO_SETTLE_MS   1000
+#define EXPO_MAX_USES    7                  // refresh after this many wakes...
+#define EXPO_MAX_AGE_S   (3 * 24 * 3600)    // ...or this long
+#define EXPO_CLIP_HI     250                // channel mean that means over/under exposed
+#define EXPO_CLIP_LO     8
+#define EXPO_CACHE_MAGIC 0x4F505845         // "EXPO"
+
+// OV2640 registers behind get_reg()/set_reg(); bit 8 selects the sensor bank
+#define OV2640_REG_GAIN  0x100
+#define OV2640_REG_REG04 0x104
+#define OV2640_REG_AEC   0x110
+#define OV2640_REG_REG45 0x145
+#define OV2640_REG_WB_R  0x0CC  // manual white balance gains, the same ones set_wb_mode() writes
+#define OV2640_REG_WB_G  0x0CD  // need to check these follow AWB while it runs
+#define OV2640_REG_WB_B  0x0CE
+#define OV2640_REG_WB_CTRL 0x0C7 // bit6 = manual white balance
+
+typedef struct {
+    uint32_t magic;
+    uint32_t saved_s;   // unix time of the refresh, 0 if the clock wasn't set
+    uint16_t aec;       // exposure, 0..1200 lines
+    uint8_t  gain;      // raw GAIN register
+    uint8_t  wb_r, wb_g, wb_b;
+    uint8_t  uses;      // captures made with these values
+} expo_cache_t;
+
+static RTC_SLOW_ATTR expo_cache_t s_expo;
+static uint8_t s_expo_age_h = 0xFF;
+
+static uint32_t wall_s(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (tv.tv_sec > 1700000000) ? (uint32_t)tv.tv_sec : 0;
+}
+
+static bool expo_cache_usable(void)
+{
+    if (s_expo.magic != EXPO_CACHE_MAGIC || s_expo.uses >= EXPO_MAX_USES) return false;
+    const uint32_t now = wall_s();
+    return !(now && s_expo.saved_s && now - s_expo.saved_s > EXPO_MAX_AGE_S);
+}
+
+static void expo_set_auto(sensor_t *s, bool on)
+{
+    s->set_exposure_ctrl(s, on);
+    s->set_gain_ctrl(s, on);
+    s->set_whitebal(s, on);
+    s->set_reg(s, OV2640_REG_WB_CTRL, 0x40, on ? 0x00 : 0x40);
+}
+
+static void expo_apply(sensor_t *s)
+{
+    expo_set_auto(s, false);
+    s->set_aec_value(s, s_expo.aec);
+    s->set_reg(s, OV2640_REG_GAIN, 0xFF, s_expo.gain);
+    s->set_reg(s, OV2640_REG_WB_R, 0xFF, s_expo.wb_r);
+    s->set_reg(s, OV2640_REG_WB_G, 0xFF, s_expo.wb_g);
+    s->set_reg(s, OV2640_REG_WB_B, 0xFF, s_expo.wb_b);
+}
+
+static void expo_save(sensor_t *s)
+{
+    s_expo.aec = (uint16_t)((s->get_reg(s, OV2640_REG_REG45, 0x3F) << 10)
+                          | (s->get_reg(s, OV2640_REG_AEC, 0xFF) << 2)
+                          |  s->get_reg(s, OV2640_REG_REG04, 0x03));
+    s_expo.gain = (uint8_t)s->get_reg(s, OV2640_REG_GAIN, 0xFF);
+    s_expo.wb_r = (uint8_t)s->get_reg(s, OV2640_REG_WB_R, 0xFF);
+    s_expo.wb_g = (uint8_t)s->get_reg(s, OV2640_REG_WB_G, 0xFF);
+    s_expo.wb_b = (uint8_t)s->get_reg(s, OV2640_REG_WB_B, 0xFF);
+    s_expo.saved_s = wall_s();
+    s_expo.uses = 0;
+    s_expo.magic = EXPO_CACHE_MAGIC;
+    ESP_LOGI(TAG, "Exposure cache refreshed: aec=%u gain=0x%02x wb=%u/%u/%u",
+             s_expo.aec, s_expo.gain, s_expo.wb_r, s_expo.wb_g, s_expo.wb_b);
+}
+
+static bool color_clipped(uint8_t r, uint8_t g, uint8_t b)
+{
+    const uint8_t hi = (r > g) ? ((r > b) ? r : b) : ((g > b) ? g : b);
+    return hi >= EXPO_CLIP_HI || hi < EXPO_CLIP_LO;
+}
+
+// Capture with cached exposure if there is a usable cache, otherwise let the
+// auto loops settle, capture, and cache what they converged to
+static esp_err_t camera_capture_settled(camera_color_t *c)
+{
+    sensor_t *s = esp_camera_sensor_get();
+    if (!s) return ESP_ERR_INVALID_STATE;
+
+    // Register layout is only known for the OV2640
+    if (s->id.PID != OV2640_PID) {
+        s_expo_age_h = 0xFF;
+#if CAMERA_LED
+        // No cache, but the pairs still need exposure held across them
+        led_set(true);
+        vTaskDelay(pdMS_TO_TICKS(EXPO_SETTLE_MS));
+        s->set_exposure_ctrl(s, 0);
+        s->set_gain_ctrl(s, 0);
+        s->set_whitebal(s, 0);
+        led_set(false);
+#endif
+        return camera_capture_color_avg(COLOR_FRAMES, c);
+    }
+
+    if (expo_cache_usable()) {
+        expo_apply(s);
+        esp_err_t err = camera_capture_color_avg(COLOR_FRAMES, c);
+        if (err == ESP_OK && !color_clipped(c->r, c->g, c->b)) {
+            s_expo.uses++;
+            const uint32_t now = wall_s();
+            uint32_t age_h = (now && s_expo.saved_s) ? (now - s_expo.saved_s) / 3600 : 0xFF;
+            s_expo_age_h = (age_h > 0xFE) ? 0xFE : (uint8_t)age_h;
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Cached exposure gave a clipped reading, re-settling");
+    }
+
+    expo_set_auto(s, true);
+#if CAMERA_LED
+    // Settle on the lit scene, then lock it for the dark/lit pairs
+    led_set(true);
+    vTaskDelay(pdMS_TO_TICKS(EXPO_SETTLE_MS));
+    expo_set_auto(s, false);
+    led_set(false);
+#else
+    vTaskDelay(pdMS_TO_TICKS(EXPO_SETTLE_MS));
+#endif
+    esp_err_t err = camera_capture_color_avg(COLOR_FRAMES, c);
+    if (err != ESP_OK) return err;
+
+    expo_save(s);
+    s_expo_age_h = 0;
+    return ESP_OK;
+}
+
+// ==============================
+// Wake driver: init + capture run in their own task
+// ==============================
+static volatile bool s_capture_done = false;
+static esp_err_t s_capture_err = ESP_OK;
+static camera_color_t s_color;
+static int16_t s_abs_mau[CAMERA_LOG_WELLS][3];
+
+// Mean of the valid regions with this role; false if there are none
+static bool role_mean(const uint32_t corrected[ROI_MAX][3], roi_role_t role, uint32_t out[3])
+{
+    uint64_t sum[3] = {0};
+    int n = 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        if (ROI_TABLE[i].role != role || !(s_color.roi_valid & (1u << i))) continue;
+        for (int c = 0; c < 3; c++) sum[c] += corrected[i][c];
+        n++;
+    }
+    for (int c = 0; c < 3; c++) out[c] = n ? (uint32_t)(sum[c] / n) : 0;
+    return n > 0;
+}
+
+// Calibrated absorbance of each sample well, against the white/black
+// patches in the frame if the table has them, otherwise against the stored
+// white reference
+static void color_calibrate(void)
+{
+    static uint32_t corrected[ROI_MAX][3];
+    esp_err_t err = colorimetry_load();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Color calibration unavailable: %s", esp_err_to_name(err));
+    }
+    for (int i = 0; i < ROI_COUNT; i++) {
+        colorimetry_correct(s_color.roi_lin_fx[i], corrected[i]);
+    }
+
+    uint32_t white[3], black[3];
+    const bool in_frame = role_mean(corrected, ROI_WHITE, white);
+    const bool have_black = role_mean(corrected, ROI_BLACK, black);
+
+    const int primary = roi_primary();
+    if (!in_frame && COLOR_STORE_WHITE) {
+        int16_t tmp[3];
+        if (!colorimetry_absorbance(corrected[primary], tmp)) {
+            colorimetry_set_white(corrected[primary]);
+        }
+    }
+
+    int well = 0;
+    for (int i = 0; i < ROI_COUNT && well < CAMERA_LOG_WELLS; i++) {
+        if (ROI_TABLE[i].role != ROI_SAMPLE) continue;
+        int16_t *mau = s_abs_mau[well++];
+        if (!(s_color.roi_valid & (1u << i))) {
+            mau[0] = mau[1] = mau[2] = COLOR_ABS_NONE;
+        } else if (in_frame) {
+            colorimetry_absorbance_ref(corrected[i], white, have_black ? black : NULL, mau);
+        } else {
+            colorimetry_absorbance(corrected[i], mau);
+        }
+    }
+    for (; well < CAMERA_LOG_WELLS; well++) {
+        s_abs_mau[well][0] = s_abs_mau[well][1] = s_abs_mau[well][2] = COLOR_ABS_NONE;
+    }
+}
+
+static void capture_task(void *arg)
+{
+    (void)arg;
+    const int64_t t0 = esp_timer_get_time();
+    s_capture_err = camera_init();
+    const int64_t init_us = esp_timer_get_time() - t0;
+#if CAMERA_LED
+    if (s_capture_err == ESP_OK) {
+        esp_err_t err = led_init();
+        s_led_ok = (err == ESP_OK);
+        if (!s_led_ok) ESP_LOGW(TAG, "LED init failed, measuring ambient: %s", esp_err_to_name(err));
+    }
+#endif
+#if CAMERA_BENCH
+    if (s_capture_err == ESP_OK) camera_bench();
+#endif
+    // Init and color capture are timed apart: the capture includes the
+    // exposure settle (or not, with a usable cache) and all COLOR_FRAMES,
+    // which would swamp the snapshot vs full init difference
+    if (s_capture_err == ESP_OK) {
+        if (s_from_snapshot) {
+            ESP_LOGI(TAG, "Camera init in %lld ms from snapshot (full init: %lld ms)",
+                     init_us / 1000, s_full_init_us / 1000);
+        } else {
+            s_full_init_us = init_us;
+            ESP_LOGI(TAG, "Camera init in %lld ms with full init", init_us / 1000);
+        }
+    }
+
+    const int64_t t1 = esp_timer_get_time();
+    if (s_capture_err == ESP_OK) {
+        s_capture_err = camera_capture_settled(&s_color);
+    }
+    if (s_capture_err == ESP_OK) {
+        color_calibrate();
+        ESP_LOGI(TAG, "Color captured in %lld ms (%d frames)",
+                 (esp_timer_get_time() - t1) / 1000, s_color.frames);
+    }
+    s_capture_done = true;
+    vTaskDelete(NULL);
+}
+
+static esp_err_t camera_drv_start(void)
+{
+    s_capture_done = false;
+    // Stay on the caller's core so the wake pipeline decides where camera work runs
+    if (xTaskCreatePinnedToCore(capture_task, "cam_capture", 4096, NULL, 5, NULL, xPortGetCoreID()) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static bool camera_drv_poll(void)
+{
+    return s_capture_done;
+}
+
+static inline uint8_t sd_16ths(uint32_t sd_fx)
+{
+    uint32_t v = (sd_fx + (1u << 11)) >> 12;
+    return (v > 255) ? 255 : (uint8_t)v;
+}
+
+static esp_err_t camera_drv_collect(log_record_t *rec)
+{
+    if (s_capture_err != ESP_OK) return s_capture_err;
+    rec->r = s_color.r;
+    rec->g = s_color.g;
+    rec->b = s_color.b;
+    rec->r_sd = sd_16ths(s_color.sd_fx[0]);
+    rec->g_sd = sd_16ths(s_color.sd_fx[1]);
+    rec->b_sd = sd_16ths(s_color.sd_fx[2]);
+    rec->color_frames = s_color.frames;
+    _Static_assert(sizeof(rec->abs_mau) == sizeof(s_abs_mau), "log record well count");
+    memcpy(rec->abs_mau, s_abs_mau, sizeof(rec->abs_mau));
+    rec->expo_age_h = s_expo_age_h;
+    rec->flags |= 0x02; // color_valid
+    return ESP_OK;
+}
+
+static void camera_drv_power_down(void)
+{
+    // Only safe once the capture task is finished with the driver
+    if (!s_capture_done || !s_cam_inited) return;
+    led_deinit();
+    esp_camera_deinit();
+    s_cam_inited = false;
+}
+
+const sensor_driver_t camera_driver = {
+    .name       = "camera",
+    .start      = camera_drv_start,
+    .poll       = camera_drv_poll,
+    .collect    = camera_drv_collect,
+    .power_down = camera_drv_power_down,
+};
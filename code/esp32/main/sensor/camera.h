@@ -1,7 +1,38 @@
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "roi_table.h"
 
-static inline void rgb565_to_rgb888(uint16_t pix, uint8_t *r, uint8_t *g, uint8_t *b);
+#define CAMERA_MAX_FRAMES 8
+
+// Sample wells whose absorbance is logged, in ROI table order
+#define CAMERA_LOG_WELLS  4
+
+// Color of the primary sample region averaged over several frames, plus
+// every region of the ROI table in linear light
+typedef struct {
+    uint8_t  r, g, b;       // rounded mean
+    uint32_t mean_fx[3];    // R, G, B mean, 16.16 fixed point
+    uint32_t lin_fx[3];     // R, G, B mean in linear light, Q16 (65536 = full scale)
+    uint32_t roi_lin_fx[ROI_MAX][3]; // the same for every ROI_TABLE region
+    uint16_t roi_valid;     // bit i = region i was inside the frame
+    uint32_t sd_fx[3];      // frame-to-frame std dev of the ROI mean, 16.16
+    uint8_t  frames;        // frames in the mean
+    uint8_t  rejected;      // frames dropped as outliers
+} camera_color_t;
 
 esp_err_t camera_init(void);
 
-esp_err_t camera_capture_color(uint8_t *out_r, uint8_t *out_g, uint8_t *out_b);
\ No newline at end of file
+esp_err_t camera_capture_color(uint8_t *out_r, uint8_t *out_g, uint8_t *out_b);
+
+// Average up to CAMERA_MAX_FRAMES frames, dropping outliers by MAD
+esp_err_t camera_capture_color_avg(int frames, camera_color_t *out);
+
+// Receives the encoded picture, possibly in several pieces
+typedef esp_err_t (*camera_jpeg_sink_t)(const uint8_t *data, size_t len, void *arg);
+
+// Takes one JPEG picture of the scene at quality 1..100 and hands it to
+// sink. Reinitialises the camera for it and leaves it off afterwards, so
+// call it after any color capture of the same wake.
+esp_err_t camera_capture_jpeg(uint8_t quality, camera_jpeg_sink_t sink, void *arg);
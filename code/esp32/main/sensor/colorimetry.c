@@ -0,0 +1,183 @@
+#include "colorimetry.h"
+#include <math.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+static const char *TAG = "COLOR";
+
+#define CAL_NAMESPACE "colorcal"
+#define CAL_KEY       "cal"
+#define CAL_VERSION   1
+
+// Clamp absorbance to what fits in int16 milli-AU
+#define ABS_MAX_MAU   30000
+
+// Longest colorimetry_load() waits for the radio task to bring NVS up
+#define NVS_WAIT_MS   2000
+
+static uint16_t s_lut[256];
+static bool s_lut_ready = false;
+
+// Survives deep sleep so NVS is only read on a cold boot
+static RTC_SLOW_ATTR color_cal_t s_cal;
+static RTC_SLOW_ATTR bool s_cal_loaded = false;
+
+static volatile bool s_nvs_ready = false;
+
+static float srgb_to_linear(float v)
+{
+    return (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+const uint16_t *colorimetry_lut(void)
+{
+    if (!s_lut_ready) {
+        for (int i = 0; i < 256; i++) {
+            // sRGB decoding curve; the OV2640's own gamma is close enough to it
+            float lin = srgb_to_linear((float)i / 255.0f);
+            uint32_t q = (uint32_t)lroundf(lin * (float)COLOR_LIN_ONE);
+            s_lut[i] = (q > 0xFFFF) ? 0xFFFF : (uint16_t)q;
+        }
+        s_lut_ready = true;
+    }
+    return s_lut;
+}
+
+void colorimetry_decode(const uint32_t fx[3], uint32_t lin[3])
+{
+    for (int c = 0; c < 3; c++) {
+        float v = (float)fx[c] / (255.0f * 65536.0f);
+        if (v > 1.0f) v = 1.0f;
+        lin[c] = (uint32_t)lroundf(srgb_to_linear(v) * (float)COLOR_LIN_ONE);
+    }
+}
+
+void colorimetry_encode(const uint32_t lin[3], uint32_t out_fx[3])
+{
+    for (int c = 0; c < 3; c++) {
+        float v = (float)lin[c] / (float)COLOR_LIN_ONE;
+        if (v > 1.0f) v = 1.0f;
+        float e = (v <= 0.0031308f) ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+        out_fx[c] = (uint32_t)lroundf(e * 255.0f * 65536.0f);
+    }
+}
+
+static void cal_defaults(color_cal_t *cal)
+{
+    memset(cal, 0, sizeof(*cal));
+    cal->version = CAL_VERSION;
+    cal->ccm[0] = cal->ccm[4] = cal->ccm[8] = COLOR_CCM_ONE;
+}
+
+void colorimetry_nvs_ready(void)
+{
+    s_nvs_ready = true;
+}
+
+esp_err_t colorimetry_load(void)
+{
+    if (s_cal_loaded) return ESP_OK;
+
+    // Identity for this wake unless the read below works; only a read that
+    // got an answer is kept, so a failure is retried next wake
+    cal_defaults(&s_cal);
+
+    // NVS belongs to the radio task, which may erase it first
+    const int64_t until = esp_timer_get_time() + (int64_t)NVS_WAIT_MS * 1000;
+    while (!s_nvs_ready) {
+        if (esp_timer_get_time() > until) return ESP_ERR_TIMEOUT;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CAL_NAMESPACE, NVS_READONLY, &h);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No color calibration, using identity");
+        s_cal_loaded = true;
+        return ESP_OK;
+    }
+    if (err != ESP_OK) return err;
+
+    color_cal_t cal;
+    size_t len = sizeof(cal);
+    err = nvs_get_blob(h, CAL_KEY, &cal, &len);
+    nvs_close(h);
+
+    if (err == ESP_OK && len == sizeof(cal) && cal.version == CAL_VERSION) {
+        s_cal = cal;
+        ESP_LOGI(TAG, "Color calibration loaded, white %s", cal.white[1] ? "set" : "not set");
+    } else if (err == ESP_OK || err == ESP_ERR_NVS_INVALID_LENGTH) {
+        ESP_LOGW(TAG, "Ignoring color calibration: wrong size or version (%u bytes)", (unsigned)len);
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        return err;
+    }
+    s_cal_loaded = true;
+    return ESP_OK;
+}
+
+void colorimetry_correct(const uint32_t lin[3], uint32_t out[3])
+{
+    for (int r = 0; r < 3; r++) {
+        int64_t acc = 0;
+        for (int c = 0; c < 3; c++) {
+            acc += (int64_t)s_cal.ccm[r * 3 + c] * lin[c];
+        }
+        acc = (acc + COLOR_CCM_ONE / 2) / COLOR_CCM_ONE;
+        out[r] = (acc < 0) ? 0 : (uint32_t)acc;
+    }
+}
+
+esp_err_t colorimetry_set_white(const uint32_t corrected[3])
+{
+    for (int c = 0; c < 3; c++) {
+        if (corrected[c] == 0) return ESP_ERR_INVALID_ARG;
+    }
+
+    color_cal_t cal = s_cal;
+    memcpy(cal.white, corrected, sizeof(cal.white));
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CAL_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, CAL_KEY, &cal, sizeof(cal));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+
+    s_cal = cal;
+    ESP_LOGI(TAG, "White reference stored: %lu/%lu/%lu",
+             (unsigned long)cal.white[0], (unsigned long)cal.white[1], (unsigned long)cal.white[2]);
+    return ESP_OK;
+}
+
+bool colorimetry_absorbance_ref(const uint32_t sample[3], const uint32_t white[3],
+                                const uint32_t black[3], int16_t out_mau[3])
+{
+    bool ok = true;
+    for (int c = 0; c < 3; c++) {
+        const int64_t k = black ? black[c] : 0;
+        const int64_t i0 = (int64_t)white[c] - k;
+        const int64_t i = (int64_t)sample[c] - k;
+        if (i0 <= 0) {
+            out_mau[c] = COLOR_ABS_NONE;
+            ok = false;
+            continue;
+        }
+        // A sample darker than the sensor can resolve reads as the clamp
+        float mau = (i <= 0) ? (float)ABS_MAX_MAU : -1000.0f * log10f((float)i / (float)i0);
+        if (mau > ABS_MAX_MAU) mau = ABS_MAX_MAU;
+        if (mau < -ABS_MAX_MAU) mau = -ABS_MAX_MAU;
+        out_mau[c] = (int16_t)lroundf(mau);
+    }
+    return ok;
+}
+
+bool colorimetry_absorbance(const uint32_t corrected[3], int16_t out_mau[3])
+{
+    return colorimetry_absorbance_ref(corrected, s_cal.white, NULL, out_mau);
+}
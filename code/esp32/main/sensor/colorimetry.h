@@ -0,0 +1,53 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Linear light is Q16: 65536 = full scale
+#define COLOR_LIN_ONE    65536u
+// Correction matrix entries are Q12: 4096 = 1.0
+#define COLOR_CCM_ONE    4096
+// Absorbance when there is no white reference to compare against
+#define COLOR_ABS_NONE   INT16_MIN
+
+// Per-device calibration, kept in NVS
+typedef struct {
+    uint16_t version;
+    int16_t  ccm[9];        // row-major 3x3, camera linear RGB -> reference linear RGB
+    uint32_t white[3];      // corrected linear RGB of the blank/white reference, 0 = none
+} color_cal_t;
+
+// 8-bit sRGB value -> Q16 linear
+const uint16_t *colorimetry_lut(void);
+
+// 8-bit sRGB in 16.16 -> Q16 linear; the LUT for values between codes
+void colorimetry_decode(const uint32_t fx[3], uint32_t lin[3]);
+
+// Q16 linear -> 8-bit sRGB in 16.16, the inverse of the LUT
+void colorimetry_encode(const uint32_t lin[3], uint32_t out_fx[3]);
+
+// Called by the radio task once nvs_flash_init() has succeeded
+void colorimetry_nvs_ready(void);
+
+// Loads the calibration from NVS (identity matrix and no white point if
+// there is none), waiting for colorimetry_nvs_ready(). Cheap once a load
+// has worked; after a failure the identity is used and the next call
+// tries again.
+esp_err_t colorimetry_load(void);
+
+// Applies the correction matrix to Q16 linear RGB
+void colorimetry_correct(const uint32_t lin[3], uint32_t out[3]);
+
+// Stores the corrected linear color as the white reference
+esp_err_t colorimetry_set_white(const uint32_t corrected[3]);
+
+// -log10((I - I_black) / (I_white - I_black)) per channel in milli-absorbance
+// units, against reference patches measured in the same frame. All inputs
+// are corrected linear RGB; black may be NULL. Returns false (and
+// COLOR_ABS_NONE) for channels where white isn't above black.
+bool colorimetry_absorbance_ref(const uint32_t sample[3], const uint32_t white[3],
+                                const uint32_t black[3], int16_t out_mau[3]);
+
+// -log10(I / I_white) per channel in milli-absorbance units, from corrected
+// linear RGB. Returns false (and COLOR_ABS_NONE) if there's no white point.
+bool colorimetry_absorbance(const uint32_t corrected[3], int16_t out_mau[3]);
@@ -0,0 +1,104 @@
+#include "driver.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rom/ets_sys.h"
+
+static const char *TAG = "DEPTH";
+
+// Moved off GPIO5/GPIO18: those are the EC drive rod and camera Y4 line,
+// and all three sensors now run at the same time.
+#define TRIG_PIN 8  // need to check these pins
+#define ECHO_PIN 9  // need to check these pins
+
+// Give up if the echo doesn't start, or doesn't end, within this long
+#define ECHO_TIMEOUT_US 30000
+
+static int64_t s_trig_us = 0;
+static volatile int64_t s_rise_us = 0;
+static volatile int64_t s_fall_us = 0;
+
+// Timestamps both edges of the echo pulse so nothing has to busy-wait on it
+static void IRAM_ATTR echo_isr(void *arg)
+{
+    (void)arg;
+    const int64_t now = esp_timer_get_time();
+    if (gpio_get_level(ECHO_PIN)) {
+        if (s_rise_us == 0) s_rise_us = now;
+    } else if (s_rise_us != 0 && s_fall_us == 0) {
+        s_fall_us = now;
+    }
+}
+
+static esp_err_t depth_start(void)
+{
+    gpio_reset_pin(TRIG_PIN);
+    gpio_set_direction(TRIG_PIN, GPIO_MODE_OUTPUT);
+    gpio_set_level(TRIG_PIN, 0);
+
+    gpio_reset_pin(ECHO_PIN);
+    gpio_set_direction(ECHO_PIN, GPIO_MODE_INPUT);
+    gpio_set_intr_type(ECHO_PIN, GPIO_INTR_ANYEDGE);
+
+    // Another driver may have installed the service already
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return err;
+
+    err = gpio_isr_handler_add(ECHO_PIN, echo_isr, NULL);
+    if (err != ESP_OK) return err;
+
+    s_rise_us = 0;
+    s_fall_us = 0;
+
+    gpio_set_level(TRIG_PIN, 0);
+    ets_delay_us(2);
+    gpio_set_level(TRIG_PIN, 1);
+    ets_delay_us(10);
+    gpio_set_level(TRIG_PIN, 0);
+    s_trig_us = esp_timer_get_time();
+
+    return ESP_OK;
+}
+
+static bool depth_poll(void)
+{
+    if (s_fall_us != 0) return true;
+
+    const int64_t now = esp_timer_get_time();
+    if (s_rise_us == 0) return now - s_trig_us > ECHO_TIMEOUT_US;
+    return now - s_rise_us > ECHO_TIMEOUT_US;
+}
+
+static esp_err_t depth_collect(log_record_t *rec)
+{
+    if (s_rise_us == 0) {
+        rec->depth_mm = -1;
+        return ESP_ERR_TIMEOUT;
+    }
+    if (s_fall_us == 0) {
+        rec->depth_mm = -2;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    const int64_t dur_us = s_fall_us - s_rise_us;
+    float mm = (float)dur_us * 0.343f / 2.0f;
+    rec->depth_mm = (int16_t)mm;
+    rec->flags |= 0x08; // depth_valid
+    ESP_LOGD(TAG, "Echo %lld us -> %d mm", dur_us, rec->depth_mm);
+    return ESP_OK;
+}
+
+static void depth_power_down(void)
+{
+    gpio_isr_handler_remove(ECHO_PIN);
+    gpio_set_level(TRIG_PIN, 0);
+}
+
+const sensor_driver_t depth_driver = {
+    .name       = "depth",
+    .start      = depth_start,
+    .poll       = depth_poll,
+    .collect    = depth_collect,
+    .power_down = depth_power_down,
+};
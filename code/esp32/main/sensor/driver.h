@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include "esp_err.h"
+#include "logger.h"
+
+// A measurement that can run alongside the others during a wake.
+//
+// start() kicks the measurement off and must return without waiting on the
+// hardware. poll() returns true once the result (or a failure) is ready,
+// collect() writes the result into its fields of the record, and
+// power_down() releases whatever start() switched on.
+typedef struct {
+    const char *name;
+    esp_err_t (*start)(void);
+    bool      (*poll)(void);
+    esp_err_t (*collect)(log_record_t *rec);
+    void      (*power_down)(void);
+} sensor_driver_t;
+
+extern const sensor_driver_t depth_driver;
+extern const sensor_driver_t camera_driver;
+extern const sensor_driver_t probe_driver;
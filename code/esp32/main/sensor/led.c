@@ -0,0 +1,66 @@
+#include "led.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_log.h"
+
+static const char *TAG = "LED";
+
+#define LED_GPIO     6   // D5, through the LED driver. need to check this pin
+#define LED_TIMER    LEDC_TIMER_1
+#define LED_CHANNEL  LEDC_CHANNEL_1
+#define LED_MODE     LEDC_LOW_SPEED_MODE
+
+// Well above the sensor's line rate so PWM doesn't band the rows
+#define LED_PWM_HZ   500000
+#define LED_RES      LEDC_TIMER_7_BIT
+#define LED_DUTY_PCT 100
+
+static bool s_ready = false;
+
+esp_err_t led_init(void)
+{
+    if (s_ready) return ESP_OK;
+
+    const ledc_timer_config_t timer = {
+        .speed_mode = LED_MODE,
+        .duty_resolution = LED_RES,
+        .timer_num = LED_TIMER,
+        .freq_hz = LED_PWM_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t err = ledc_timer_config(&timer);
+    if (err != ESP_OK) return err;
+
+    const ledc_channel_config_t channel = {
+        .gpio_num = LED_GPIO,
+        .speed_mode = LED_MODE,
+        .channel = LED_CHANNEL,
+        .timer_sel = LED_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    err = ledc_channel_config(&channel);
+    if (err != ESP_OK) return err;
+
+    s_ready = true;
+    return ESP_OK;
+}
+
+void led_set(bool on)
+{
+    if (!s_ready) return;
+    const uint32_t full = (1u << LED_RES) - 1;
+    ledc_set_duty(LED_MODE, LED_CHANNEL, on ? full * LED_DUTY_PCT / 100 : 0);
+    ledc_update_duty(LED_MODE, LED_CHANNEL);
+}
+
+void led_deinit(void)
+{
+    if (!s_ready) return;
+    ledc_stop(LED_MODE, LED_CHANNEL, 0);
+    gpio_reset_pin(LED_GPIO);
+    gpio_set_direction(LED_GPIO, GPIO_MODE_OUTPUT);
+    gpio_set_level(LED_GPIO, 0);
+    s_ready = false;
+    ESP_LOGD(TAG, "LED off");
+}
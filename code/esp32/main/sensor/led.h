@@ -0,0 +1,13 @@
+#pragma once
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Illumination LED for the color sample, on LEDC timer 1 / channel 1 (the
+// camera's XCLK has timer 0 / channel 0)
+esp_err_t led_init(void);
+
+// Safe to call from the camera task's stream callback
+void led_set(bool on);
+
+// LED off and the pin parked low
+void led_deinit(void);
@@ -1,4 +1,5 @@
 #include "logger.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "esp_log.h"
@@ -8,8 +9,98 @@
 static const char *TAG = "LOGGER";
 static wl_handle_t s_wl = WL_INVALID_HANDLE;
 
-#define MOUNT_POINT "/storage"
+#define MOUNT_POINT LOGGER_MOUNT_POINT
 #define LOG_PATH    MOUNT_POINT "/depthlog.bin"
+#define LOG_TMP_PATH MOUNT_POINT "/LOGNEW.TMP"
+
+// Record written by the firmware before log files had a header
+typedef struct __attribute__((packed)) {
+    uint32_t unix_s;
+    int16_t  depth_mm;   // -1 if the echo timed out
+    uint8_t  r, g, b;
+    uint8_t  flags;      // bit0=time_valid, bit1=color_valid
+} log_record_v1_t;
+
+static const log_header_t s_header = {
+    .magic = LOGGER_MAGIC,
+    .version = LOGGER_VERSION,
+    .record_size = sizeof(log_record_t),
+};
+
+static esp_err_t write_header(FILE *f)
+{
+    return fwrite(&s_header, sizeof(s_header), 1, f) == 1 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t convert_v1(void)
+{
+    FILE *in = fopen(LOG_PATH, "rb");
+    if (!in) return ESP_FAIL;
+    remove(LOG_TMP_PATH);
+    FILE *out = fopen(LOG_TMP_PATH, "wb");
+    if (!out) {
+        fclose(in);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = write_header(out);
+    log_record_v1_t old;
+    uint32_t n = 0;
+    while (err == ESP_OK && fread(&old, sizeof(old), 1, in) == 1) {
+        log_record_t rec = {
+            .unix_s = old.unix_s,
+            .depth_mm = old.depth_mm,
+            .r = old.r, .g = old.g, .b = old.b,
+            .flags = (uint8_t)((old.flags & 0x03) | (old.depth_mm >= 0 ? 0x08 : 0)),
+            .expo_age_h = 255,
+        };
+        for (int w = 0; w < 4; w++) {
+            for (int c = 0; c < 3; c++) rec.abs_mau[w][c] = INT16_MIN;
+        }
+        if (fwrite(&rec, sizeof(rec), 1, out) != 1) err = ESP_FAIL;
+        n++;
+    }
+    fclose(in);
+    if (fclose(out) != 0 && err == ESP_OK) err = ESP_FAIL;
+
+    if (err == ESP_OK && remove(LOG_PATH) != 0) err = ESP_FAIL;
+    if (err == ESP_OK && rename(LOG_TMP_PATH, LOG_PATH) != 0) err = ESP_FAIL;
+    if (err != ESP_OK) {
+        remove(LOG_TMP_PATH);
+        return err;
+    }
+    ESP_LOGI(TAG, "Converted %lu records from the headerless log", (unsigned long)n);
+    return ESP_OK;
+}
+
+// Leaves LOG_PATH absent, empty or headed by s_header
+static void check_file(void)
+{
+    FILE *f = fopen(LOG_PATH, "rb");
+    if (!f) return;  // the first append writes the header
+
+    log_header_t hdr;
+    const bool have = fread(&hdr, sizeof(hdr), 1, f) == 1;
+    fseek(f, 0, SEEK_END);
+    const long sz = ftell(f);
+    fclose(f);
+
+    if (sz <= 0) return;
+    if (have && memcmp(&hdr, &s_header, sizeof(hdr)) == 0) return;
+
+    if ((!have || hdr.magic != LOGGER_MAGIC) && sz % (long)sizeof(log_record_v1_t) == 0 &&
+        convert_v1() == ESP_OK) {
+        return;
+    }
+
+    if (have && hdr.magic == LOGGER_MAGIC) {
+        ESP_LOGW(TAG, "Discarding log: version %u with %u-byte records, expected %u with %u",
+                 hdr.version, hdr.record_size, s_header.version, s_header.record_size);
+    } else {
+        ESP_LOGW(TAG, "Discarding unreadable %ld-byte log", sz);
+    }
+    remove(LOG_PATH);
+}
 
 esp_err_t logger_init(void)
 {
@@ -27,6 +118,7 @@ esp_err_t logger_init(void)
         return err;
     }
     ESP_LOGI(TAG, "Mounted flash FAT at %s", MOUNT_POINT);
+    check_file();
     return ESP_OK;
 }
 
@@ -39,9 +131,11 @@ esp_err_t logger_append(const log_record_t *rec)
     FILE *f = fopen(LOG_PATH, "ab");
     if (!f) return ESP_FAIL;
 
-    size_t w = fwrite(rec, sizeof(*rec), 1, f);
+    fseek(f, 0, SEEK_END);
+    err = (ftell(f) == 0) ? write_header(f) : ESP_OK;
+    if (err == ESP_OK && fwrite(rec, sizeof(*rec), 1, f) != 1) err = ESP_FAIL;
     fclose(f);
-    return (w == 1) ? ESP_OK : ESP_FAIL;
+    return err;
 }
 
 esp_err_t logger_count(uint32_t *out_count)
@@ -59,8 +153,8 @@ esp_err_t logger_count(uint32_t *out_count)
     long sz = ftell(f);
     fclose(f);
 
-    if (sz <= 0) return ESP_OK;
-    *out_count = (uint32_t)(sz / (long)sizeof(log_record_t));
+    if (sz <= (long)sizeof(log_header_t)) return ESP_OK;
+    *out_count = (uint32_t)((sz - (long)sizeof(log_header_t)) / (long)sizeof(log_record_t));
     return ESP_OK;
 }
 
@@ -80,6 +174,7 @@ esp_err_t logger_read_all_and_send(void (*send_fn)(const log_record_t *rec, uint
 
     FILE *f = fopen(LOG_PATH, "rb");
     if (!f) return ESP_FAIL;
+    fseek(f, sizeof(log_header_t), SEEK_SET);
 
     log_record_t rec;
     for (uint32_t i = 0; i < count; i++) {
@@ -100,7 +195,9 @@ esp_err_t logger_clear(void)
     // Truncate by reopening in write mode
     FILE *f = fopen(LOG_PATH, "wb");
     if (!f) return ESP_FAIL;
+    err = write_header(f);
     fclose(f);
+    if (err != ESP_OK) return err;
     ESP_LOGI(TAG, "Log cleared.");
     return ESP_OK;
 }
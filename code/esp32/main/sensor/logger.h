@@ -2,11 +2,36 @@
 #include <stdint.h>
 #include "esp_err.h"
 
+// Flash FAT volume shared with the snapshot archive
+#define LOGGER_MOUNT_POINT "/storage"
+
+// The log file starts with a header naming the record layout, so a unit
+// reflashed with un-uploaded records converts or discards them instead of
+// misreading them. Bump LOGGER_VERSION whenever log_record_t changes.
+#define LOGGER_MAGIC   0x474F4C44u  // "DLOG"
+#define LOGGER_VERSION 2            // 1 was the baseline's headerless 10-byte record
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;  // sizeof(log_record_t)
+} log_header_t;
+
 typedef struct __attribute__((packed)) {
     uint32_t unix_s;     // 0 if not synced
-    int16_t  depth_mm;   // depth in mm
+    int16_t  depth_mm;   // depth in mm, negative if not sampled
     uint8_t  r, g, b;    // 0 unless daily color sample
-    uint8_t  flags;      // bit0=time_valid, bit1=color_valid
+    uint8_t  flags;      // bit0=time_valid, bit1=color_valid, bit2=probe_valid, bit3=depth_valid
+    int16_t  temp_cc;    // probe temperature in 0.01 C
+    uint16_t salinity_cppt; // salinity in 0.01 ppt
+    uint16_t depth_dt_ds;   // time since the previous depth sample in 0.1 s, 0 if unknown
+    uint16_t batt_mv;    // battery voltage, 0 if unread
+    uint8_t  soc_pct;    // estimated state of charge
+    uint8_t  power_level; // power_level_t in effect for this wake
+    uint8_t  expo_age_h;  // hours since the camera exposure cache was refreshed, 0 = this capture, 255 = unknown
+    uint8_t  r_sd, g_sd, b_sd; // frame-to-frame std dev of r/g/b, 1/16 count (saturates at 255)
+    uint8_t  color_frames; // frames averaged into r/g/b after outlier rejection
+    int16_t  abs_mau[4][3]; // calibrated R, G, B absorbance of the first 4 sample wells, milli-AU; INT16_MIN if none
 } log_record_t;
 
 esp_err_t logger_init(void);
@@ -0,0 +1,67 @@
+#include "power_policy.h"
+#include "schedule.h"
+
+// SOC below which each level is entered; leaving needs HYSTERESIS_PCT more
+#define SAVE_BELOW_PCT     60
+#define LOW_BELOW_PCT      35
+#define CRITICAL_BELOW_PCT 15
+#define HYSTERESIS_PCT     5
+
+// Peak-sun block around solar noon (battery_calculator.py: PSH 4.9 h)
+#define SOLAR_NOON_HOUR 12
+#define SUN_HALF_HOURS  2
+
+static const uint8_t ENTER_BELOW[] = {
+    [POWER_SAVE]     = SAVE_BELOW_PCT,
+    [POWER_LOW]      = LOW_BELOW_PCT,
+    [POWER_CRITICAL] = CRITICAL_BELOW_PCT,
+};
+
+static power_level_t level_for(uint8_t soc, power_level_t prev)
+{
+    power_level_t level = POWER_NORMAL;
+    for (int l = POWER_SAVE; l <= POWER_CRITICAL; l++) {
+        // Stay in a level we're already at or below until clearly above it
+        uint8_t threshold = ENTER_BELOW[l] + (prev >= l ? HYSTERESIS_PCT : 0);
+        if (soc < threshold) level = (power_level_t)l;
+    }
+    return level;
+}
+
+static bool in_sun(int solar_hour)
+{
+    // Unknown time: don't starve the deferred channels
+    if (solar_hour < 0) return true;
+    return solar_hour >= SOLAR_NOON_HOUR - SUN_HALF_HOURS && solar_hour <= SOLAR_NOON_HOUR + SUN_HALF_HOURS;
+}
+
+power_plan_t power_plan(uint8_t soc_pct, int solar_hour, power_level_t prev)
+{
+    const bool sun = in_sun(solar_hour);
+    power_plan_t plan = {.level = level_for(soc_pct, prev)};
+
+    switch (plan.level) {
+    case POWER_NORMAL:
+        plan.stretch = 1;
+        plan.channels = CH_BIT(CH_DEPTH) | CH_BIT(CH_PROBE) | CH_BIT(CH_COLOR) | CH_BIT(CH_SNAPSHOT);
+        plan.upload = true;
+        break;
+    case POWER_SAVE:
+        plan.stretch = 2;
+        plan.channels = CH_BIT(CH_DEPTH) | CH_BIT(CH_PROBE) | (sun ? CH_BIT(CH_COLOR) | CH_BIT(CH_SNAPSHOT) : 0);
+        plan.upload = true;
+        break;
+    case POWER_LOW:
+        plan.stretch = 4;
+        plan.channels = CH_BIT(CH_DEPTH) | (sun ? CH_BIT(CH_PROBE) : 0);
+        plan.upload = sun;
+        break;
+    case POWER_CRITICAL:
+    default:
+        plan.stretch = 8;
+        plan.channels = CH_BIT(CH_DEPTH);
+        plan.upload = false;
+        break;
+    }
+    return plan;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Plain C with no ESP-IDF dependencies so docs/tools/policy_replay.py can
+// build it on the host and replay the battery calculator against it.
+
+typedef enum {
+    POWER_NORMAL,
+    POWER_SAVE,
+    POWER_LOW,
+    POWER_CRITICAL,
+} power_level_t;
+
+typedef struct {
+    power_level_t level;
+    uint8_t  stretch;  // multiply every sampling period by this
+    uint32_t channels; // CH_BIT mask of channels allowed to run now
+    bool     upload;   // answer the boat's upload request now
+} power_plan_t;
+
+// Picks a plan from the state of charge and the local solar hour (0-23, or -1
+// if the clock isn't synced), i.e. UTC shifted by the site's longitude rather
+// than civil time. prev is the level from the last wake, for hysteresis.
+power_plan_t power_plan(uint8_t soc_pct, int solar_hour, power_level_t prev);
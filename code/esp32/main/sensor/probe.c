@@ -0,0 +1,195 @@
+#include "driver.h"
+#include <math.h>
+#include "driver/gpio.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "PROBE";
+
+// ==============================
+// 4-wire AC EC probe + NTC (see updates/week13)
+// ==============================
+#define DRIVE_A_GPIO 5 // 1k -> Rod1
+#define DRIVE_B_GPIO 4 // 1k -> Rod4
+#define SENSE_P_GPIO 3 // Rod2
+#define SENSE_N_GPIO 7 // Rod3
+#define THERM_GPIO   2 // 10k/3950 NTC divider
+
+#define SETTLE_A_US 15000 // settle after polarity change
+#define SETTLE_B_US 8000
+#define SAMPLES     32    // ADC samples per half-cycle, median taken
+#define DELTA_MIN   15    // reject tiny |P-N|
+
+// Seawater conversion
+#define EC_ALPHA_PER_C   0.019f
+#define MSCM_PER_PPT_25C (56.2f / 35.0f)
+#define A_MAP            (-0.923077f)
+#define B_MAP            189.6f
+
+// Thermistor (3V3 -> 10k -> node -> NTC -> GND)
+#define THERM_R_SER   10000.0f
+#define THERM_R0      10000.0f
+#define THERM_BETA    3950.0f
+#define TEMP_OFFSET_C (-3.0f)
+
+typedef enum {
+    PROBE_IDLE,
+    PROBE_PHASE_A,
+    PROBE_PHASE_B,
+    PROBE_DONE,
+} probe_state_t;
+
+static adc_oneshot_unit_handle_t s_adc = NULL;
+static adc_channel_t s_ch_p, s_ch_n, s_ch_therm;
+static esp_timer_handle_t s_timer = NULL;
+static volatile probe_state_t s_state = PROBE_IDLE;
+static uint16_t s_d1, s_d2;
+static int s_therm_raw;
+
+static void set_drive(bool a_hi, bool b_hi)
+{
+    gpio_set_level(DRIVE_A_GPIO, a_hi);
+    gpio_set_level(DRIVE_B_GPIO, b_hi);
+}
+
+// Median of |P-N| over SAMPLES reads
+static uint16_t sample_diff(void)
+{
+    uint16_t buf[SAMPLES];
+    for (int i = 0; i < SAMPLES; i++) {
+        int p = 0, n = 0;
+        adc_oneshot_read(s_adc, s_ch_p, &p);
+        adc_oneshot_read(s_adc, s_ch_n, &n);
+        buf[i] = (uint16_t)((p > n) ? (p - n) : (n - p));
+    }
+    for (int i = 1; i < SAMPLES; i++) {
+        uint16_t k = buf[i];
+        int j = i - 1;
+        while (j >= 0 && buf[j] > k) { buf[j + 1] = buf[j]; j--; }
+        buf[j + 1] = k;
+    }
+    return buf[SAMPLES / 2];
+}
+
+// Each settle period ends here instead of in a busy wait
+static void settle_done(void *arg)
+{
+    (void)arg;
+    switch (s_state) {
+    case PROBE_PHASE_A:
+        s_d1 = sample_diff();
+        set_drive(false, true);
+        s_state = PROBE_PHASE_B;
+        esp_timer_start_once(s_timer, SETTLE_B_US);
+        break;
+    case PROBE_PHASE_B:
+        s_d2 = sample_diff();
+        set_drive(false, false);
+        adc_oneshot_read(s_adc, s_ch_therm, &s_therm_raw);
+        s_state = PROBE_DONE;
+        break;
+    default:
+        break;
+    }
+}
+
+static esp_err_t add_channel(int gpio, adc_channel_t *out)
+{
+    adc_unit_t unit;
+    esp_err_t err = adc_oneshot_io_to_channel(gpio, &unit, out);
+    if (err != ESP_OK) return err;
+    if (unit != ADC_UNIT_1) return ESP_ERR_NOT_SUPPORTED;
+
+    const adc_oneshot_chan_cfg_t cfg = {
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    return adc_oneshot_config_channel(s_adc, *out, &cfg);
+}
+
+static esp_err_t probe_start(void)
+{
+    const adc_oneshot_unit_init_cfg_t unit_cfg = {.unit_id = ADC_UNIT_1};
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &s_adc);
+    if (err != ESP_OK) return err;
+
+    if ((err = add_channel(SENSE_P_GPIO, &s_ch_p)) != ESP_OK) return err;
+    if ((err = add_channel(SENSE_N_GPIO, &s_ch_n)) != ESP_OK) return err;
+    if ((err = add_channel(THERM_GPIO, &s_ch_therm)) != ESP_OK) return err;
+
+    const gpio_config_t drive = {
+        .pin_bit_mask = (1ULL << DRIVE_A_GPIO) | (1ULL << DRIVE_B_GPIO),
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    gpio_config(&drive);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = settle_done,
+        .name = "probe_settle",
+    };
+    err = esp_timer_create(&timer_args, &s_timer);
+    if (err != ESP_OK) return err;
+
+    s_state = PROBE_PHASE_A;
+    set_drive(true, false);
+    return esp_timer_start_once(s_timer, SETTLE_A_US);
+}
+
+static bool probe_poll(void)
+{
+    return s_state == PROBE_DONE;
+}
+
+static float therm_c(int raw)
+{
+    if (raw <= 0 || raw >= 4095) return NAN;
+    float r_ntc = THERM_R_SER * (float)raw / (4095.0f - (float)raw);
+    const float T0K = 273.15f + 25.0f;
+    float invT = (1.0f / T0K) + (1.0f / THERM_BETA) * logf(r_ntc / THERM_R0);
+    return (1.0f / invT) - 273.15f + TEMP_OFFSET_C;
+}
+
+static esp_err_t probe_collect(log_record_t *rec)
+{
+    uint16_t d = (uint16_t)((s_d1 + s_d2) / 2);
+    float t = therm_c(s_therm_raw);
+    if (d < DELTA_MIN || isnan(t)) {
+        ESP_LOGW(TAG, "Bad probe reading d=%u raw_t=%d", d, s_therm_raw);
+        return ESP_FAIL;
+    }
+
+    float n = 4095.0f / (float)d;
+    float ec25 = A_MAP * n + B_MAP;
+    float ppt = ec25 / MSCM_PER_PPT_25C;
+    if (ppt < 0.0f) ppt = 0.0f;
+
+    rec->temp_cc = (int16_t)lroundf(t * 100.0f);
+    rec->salinity_cppt = (uint16_t)lroundf(ppt * 100.0f);
+    rec->flags |= 0x04; // probe_valid
+    ESP_LOGD(TAG, "n=%.3f EC25=%.2f mS/cm ppt=%.2f T=%.2f C", n, ec25, ppt, t);
+    return ESP_OK;
+}
+
+static void probe_power_down(void)
+{
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+    }
+    set_drive(false, false);
+    if (s_adc) {
+        adc_oneshot_del_unit(s_adc);
+        s_adc = NULL;
+    }
+    s_state = PROBE_IDLE;
+}
+
+const sensor_driver_t probe_driver = {
+    .name       = "probe",
+    .start      = probe_start,
+    .poll       = probe_poll,
+    .collect    = probe_collect,
+    .power_down = probe_power_down,
+};
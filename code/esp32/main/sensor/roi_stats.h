@@ -0,0 +1,212 @@
+#pragma once
+// RGB565 region statistics shared by the sensor firmware and
+// code/colormetric_debug. Header-only so the Arduino debug sketch can use it
+// without a component of its own.
+//
+// Each pixel only bumps a counter for its raw 5/6/5 codes. Sums, sums of
+// squares and the 32-bin histograms all come out of those counters at the
+// end, so the per-pixel loop has no divides, no bounds checks and no
+// conversion. Results match roi_stats_ref(), which converts every pixel;
+// docs/tools/roi_stats_check.py compares the two on the host.
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ROI_STATS_BINS 32
+
+// Pixel layout flags
+#define ROI_STATS_BGR      (1u << 0) // red in the low 5 bits
+#define ROI_STATS_BIG_END  (1u << 1) // high byte first
+#define ROI_STATS_YUV422   (1u << 2) // YUYV instead of RGB565; for roi_multi_t
+
+typedef struct {
+    int x, y, w, h;
+} roi_rect_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum[3];                    // R, G, B in 0..255
+    uint64_t sumsq[3];
+    uint32_t hist[3][ROI_STATS_BINS];   // 0..255 in 8-count bins, only if asked for
+} roi_stats_t;
+
+// Running counts of the raw codes, fed a row at a time
+typedef struct {
+    uint32_t flags;
+    uint32_t r5[32], g6[64], b5[32];    // indexed by the 565 fields as stored
+} roi_stats_acc_t;
+
+static inline void roi_stats_begin(roi_stats_acc_t *acc, uint32_t flags)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->flags = flags;
+}
+
+static inline void roi_stats_px(roi_stats_acc_t *acc, uint32_t p)
+{
+    acc->r5[(p >> 11) & 0x1F]++;
+    acc->g6[(p >> 5) & 0x3F]++;
+    acc->b5[p & 0x1F]++;
+}
+
+// Adds n pixels of a row starting at pixel x. Rows must be 2-byte aligned.
+static inline void roi_stats_add_row(roi_stats_acc_t *acc, const uint8_t *row, int x, int n)
+{
+    const uint16_t *p = (const uint16_t *)(const void *)row + x;
+    const bool swap = (acc->flags & ROI_STATS_BIG_END) != 0;
+
+    if (n > 0 && ((uintptr_t)p & 2)) {
+        uint32_t v = *p++;
+        roi_stats_px(acc, swap ? (uint16_t)((v << 8) | (v >> 8)) : v);
+        n--;
+    }
+
+    // Two pixels per 32-bit load; little-endian, so the first pixel is the low half
+    const uint32_t *w = (const uint32_t *)(const void *)p;
+    if (swap) {
+        for (; n >= 2; n -= 2) {
+            uint32_t v = *w++;
+            v = ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+            roi_stats_px(acc, v & 0xFFFF);
+            roi_stats_px(acc, v >> 16);
+        }
+    } else {
+        for (; n >= 2; n -= 2) {
+            uint32_t v = *w++;
+            roi_stats_px(acc, v & 0xFFFF);
+            roi_stats_px(acc, v >> 16);
+        }
+    }
+
+    if (n > 0) {
+        uint32_t v = *(const uint16_t *)(const void *)w;
+        roi_stats_px(acc, swap ? (uint16_t)((v << 8) | (v >> 8)) : v);
+    }
+}
+
+static inline void roi_stats_channel(const uint32_t *codes, int n_codes, int max_code,
+                                     int c, bool hist, roi_stats_t *out)
+{
+    for (int k = 0; k < n_codes; k++) {
+        if (!codes[k]) continue;
+        const uint32_t v = (uint32_t)k * 255 / (uint32_t)max_code;
+        out->sum[c] += codes[k] * v;
+        out->sumsq[c] += (uint64_t)codes[k] * v * v;
+        if (hist) out->hist[c][v >> 3] += codes[k];
+    }
+}
+
+// hist = false leaves out->hist zeroed
+static inline void roi_stats_end(const roi_stats_acc_t *acc, bool hist, roi_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    const bool bgr = (acc->flags & ROI_STATS_BGR) != 0;
+
+    roi_stats_channel(acc->r5, 32, 31, bgr ? 2 : 0, hist, out);
+    roi_stats_channel(acc->g6, 64, 63, 1, hist, out);
+    roi_stats_channel(acc->b5, 32, 31, bgr ? 0 : 2, hist, out);
+
+    for (int k = 0; k < 64; k++) out->count += acc->g6[k];
+}
+
+static inline uint64_t roi_stats_lut_channel(const uint32_t *codes, int n_codes, int max_code,
+                                             const uint16_t lut[256])
+{
+    uint64_t sum = 0;
+    for (int k = 0; k < n_codes; k++) {
+        if (codes[k]) sum += (uint64_t)codes[k] * lut[(uint32_t)k * 255 / (uint32_t)max_code];
+    }
+    return sum;
+}
+
+// Sums lut[value] instead of value, per channel; for transfer curves that
+// have to be applied before averaging
+static inline void roi_stats_lut_sum(const roi_stats_acc_t *acc, const uint16_t lut[256], uint64_t sum[3])
+{
+    const bool bgr = (acc->flags & ROI_STATS_BGR) != 0;
+    sum[bgr ? 2 : 0] = roi_stats_lut_channel(acc->r5, 32, 31, lut);
+    sum[1]           = roi_stats_lut_channel(acc->g6, 64, 63, lut);
+    sum[bgr ? 0 : 2] = roi_stats_lut_channel(acc->b5, 32, 31, lut);
+}
+
+// YUV422 (Y0 U Y1 V) sums. Each pixel counts the chroma of its pair, so a
+// region starting or ending on an odd pixel is weighted the same as RGB565.
+typedef struct {
+    uint32_t count;
+    uint32_t sum[3];    // Y, U, V, full 8 bits each
+    uint64_t sumsq[3];
+} roi_yuv_acc_t;
+
+static inline void roi_yuv_add_row(roi_yuv_acc_t *acc, const uint8_t *row, int x, int n)
+{
+    for (int px = x; px < x + n; px++) {
+        const uint8_t *pair = row + (size_t)(px & ~1) * 2;
+        const uint32_t v[3] = {row[(size_t)px * 2], pair[1], pair[3]};
+        for (int c = 0; c < 3; c++) {
+            acc->sum[c] += v[c];
+            acc->sumsq[c] += v[c] * v[c];
+        }
+    }
+    acc->count += (uint32_t)(n > 0 ? n : 0);
+}
+
+// Clips rect to the frame; false if nothing is left
+static inline bool roi_stats_clip(roi_rect_t *r, int width, int height)
+{
+    int x0 = r->x < 0 ? 0 : r->x;
+    int y0 = r->y < 0 ? 0 : r->y;
+    int x1 = r->x + r->w > width ? width : r->x + r->w;
+    int y1 = r->y + r->h > height ? height : r->y + r->h;
+    if (x1 <= x0 || y1 <= y0) return false;
+    r->x = x0; r->y = y0; r->w = x1 - x0; r->h = y1 - y0;
+    return true;
+}
+
+// Statistics of one rectangle of a frame, stride in bytes
+static inline bool roi_stats(const uint8_t *buf, int width, int height, size_t stride,
+                             roi_rect_t rect, uint32_t flags, bool hist, roi_stats_t *out)
+{
+    roi_stats_acc_t acc;
+    roi_stats_begin(&acc, flags);
+    if (!roi_stats_clip(&rect, width, height)) {
+        roi_stats_end(&acc, hist, out);
+        return false;
+    }
+    for (int y = rect.y; y < rect.y + rect.h; y++) {
+        roi_stats_add_row(&acc, buf + (size_t)y * stride, rect.x, rect.w);
+    }
+    roi_stats_end(&acc, hist, out);
+    return true;
+}
+
+// Straightforward per-pixel version to check roi_stats() against
+static inline bool roi_stats_ref(const uint8_t *buf, int width, int height, size_t stride,
+                                 roi_rect_t rect, uint32_t flags, bool hist, roi_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    for (int y = rect.y; y < rect.y + rect.h; y++) {
+        if (y < 0 || y >= height) continue;
+        for (int x = rect.x; x < rect.x + rect.w; x++) {
+            if (x < 0 || x >= width) continue;
+            const uint8_t *q = buf + (size_t)y * stride + (size_t)x * 2;
+            uint16_t pix = (flags & ROI_STATS_BIG_END) ? (uint16_t)((q[0] << 8) | q[1])
+                                                       : (uint16_t)(q[0] | (q[1] << 8));
+            uint32_t v[3] = {
+                ((pix >> 11) & 0x1F) * 255u / 31,
+                ((pix >> 5) & 0x3F) * 255u / 63,
+                (pix & 0x1F) * 255u / 31,
+            };
+            if (flags & ROI_STATS_BGR) {
+                uint32_t t = v[0]; v[0] = v[2]; v[2] = t;
+            }
+            for (int c = 0; c < 3; c++) {
+                out->sum[c] += v[c];
+                out->sumsq[c] += (uint64_t)v[c] * v[c];
+                if (hist) out->hist[c][v[c] >> 3]++;
+            }
+            out->count++;
+        }
+    }
+    return out->count > 0;
+}
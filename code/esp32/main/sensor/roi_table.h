@@ -0,0 +1,100 @@
+#pragma once
+// Regions of the frame to measure: reagent wells and the white/black
+// reference patches of the cartridge. Shared with code/colormetric_debug so
+// the debug server shows the same regions the sensor logs.
+//
+// All regions are evaluated together in one pass over the rows, so adding
+// wells doesn't cost extra captures.
+#include <math.h>
+#include "roi_stats.h"
+
+#define ROI_MAX 16
+
+typedef enum {
+    ROI_SAMPLE = 0,
+    ROI_WHITE,
+    ROI_BLACK,
+} roi_role_t;
+
+typedef struct {
+    int16_t x, y, w, h; // QVGA (320x240) pixels
+    uint8_t role;       // roi_role_t
+} roi_def_t;
+
+// The first ROI_SAMPLE is the one reported as r/g/b. The default is the 7x7
+// center window the sensor has always used; add the cartridge's wells and
+// patches here. need to check positions against the cartridge
+static const roi_def_t ROI_TABLE[] = {
+    {157, 117, 7, 7, ROI_SAMPLE},
+};
+#define ROI_COUNT ((int)(sizeof(ROI_TABLE) / sizeof(ROI_TABLE[0])))
+typedef char roi_table_fits[(sizeof(ROI_TABLE) / sizeof(ROI_TABLE[0]) <= ROI_MAX) ? 1 : -1];
+
+typedef struct {
+    int x0, x1, y0, y1; // inclusive frame pixels; x1 < x0 when outside the frame
+} roi_span_t;
+
+typedef struct {
+    int first_row, last_row;
+    bool yuv;           // frames are YUV422, sums go to yuv[] instead of stats[]
+    roi_span_t span[ROI_MAX];
+    roi_stats_acc_t stats[ROI_MAX];
+    roi_yuv_acc_t yuv_acc[ROI_MAX];
+} roi_multi_t;
+
+static inline bool roi_multi_valid(const roi_multi_t *m, int i)
+{
+    return m->span[i].x1 >= m->span[i].x0;
+}
+
+// Places the table on a w x h frame that shows the QVGA field around its
+// center at px_per_qvga frame pixels per QVGA pixel
+static inline void roi_multi_begin(roi_multi_t *m, int w, int h, float px_per_qvga, uint32_t flags)
+{
+    m->first_row = h;
+    m->last_row = -1;
+    m->yuv = (flags & ROI_STATS_YUV422) != 0;
+    for (int i = 0; i < ROI_COUNT; i++) {
+        const roi_def_t *d = &ROI_TABLE[i];
+        roi_rect_t r;
+        r.x = (int)floorf((d->x - 160) * px_per_qvga + 0.5f) + w / 2;
+        r.y = (int)floorf((d->y - 120) * px_per_qvga + 0.5f) + h / 2;
+        r.w = (int)floorf((d->x + d->w - 160) * px_per_qvga + 0.5f) + w / 2 - r.x;
+        r.h = (int)floorf((d->y + d->h - 120) * px_per_qvga + 0.5f) + h / 2 - r.y;
+
+        roi_span_t *s = &m->span[i];
+        if (roi_stats_clip(&r, w, h)) {
+            s->x0 = r.x; s->x1 = r.x + r.w - 1;
+            s->y0 = r.y; s->y1 = r.y + r.h - 1;
+            if (s->y0 < m->first_row) m->first_row = s->y0;
+            if (s->y1 > m->last_row) m->last_row = s->y1;
+        } else {
+            s->x0 = s->y0 = 0;
+            s->x1 = s->y1 = -1;
+        }
+        roi_stats_begin(&m->stats[i], flags);
+        memset(&m->yuv_acc[i], 0, sizeof(m->yuv_acc[i]));
+    }
+}
+
+static inline void roi_multi_add_row(roi_multi_t *m, int y, const uint8_t *row)
+{
+    for (int i = 0; i < ROI_COUNT; i++) {
+        const roi_span_t *s = &m->span[i];
+        if (y < s->y0 || y > s->y1) continue;
+        if (m->yuv) {
+            roi_yuv_add_row(&m->yuv_acc[i], row, s->x0, s->x1 - s->x0 + 1);
+        } else {
+            roi_stats_add_row(&m->stats[i], row, s->x0, s->x1 - s->x0 + 1);
+        }
+    }
+}
+
+// Index of the first ROI_SAMPLE, or -1
+static inline int roi_primary(void)
+{
+    for (int i = 0; i < ROI_COUNT; i++) {
+        if (ROI_TABLE[i].role == ROI_SAMPLE) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,100 @@
+#include "schedule.h"
+#include <stdbool.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+
+static const char *TAG = "SCHEDULE";
+
+typedef struct {
+    const char *name;
+    uint32_t period_s;
+    uint32_t phase_s; // offset of the first slot from the period grid
+    bool solar;       // phase_s is local solar time rather than UTC
+} channel_cfg_t;
+
+static const channel_cfg_t CHANNELS[CH_COUNT] = {
+    [CH_DEPTH] = {"depth", 10, 0, false},
+    [CH_PROBE] = {"probe", 30 * 60, 0, false},
+    [CH_COLOR] = {"color", 24 * 60 * 60, 12 * 60 * 60, true}, // solar noon, for daylight
+    [CH_SNAPSHOT] = {"snapshot", 24 * 60 * 60, 12 * 60 * 60, true}, // same wake as color
+};
+
+// The RTC slow clock drifts, so accept a wake this much before the slot
+#define EARLY_WAKE_MS 500
+
+// Shortest sleep we bother with
+#define MIN_SLEEP_MS 1000
+
+// Persist across deep sleep; 0 means due now / default period
+static RTC_SLOW_ATTR int64_t s_next_due_ms[CH_COUNT];
+static RTC_SLOW_ATTR uint32_t s_period_ms[CH_COUNT];
+static RTC_SLOW_ATTR uint8_t s_stretch;
+
+static int64_t period_ms(channel_t ch)
+{
+    int64_t p = s_period_ms[ch] ? s_period_ms[ch] : (int64_t)CHANNELS[ch].period_s * 1000;
+    return s_stretch > 1 ? p * s_stretch : p;
+}
+
+// First slot of the channel's grid strictly after after_ms
+static int64_t next_slot(channel_t ch, int64_t after_ms)
+{
+    const int64_t period = period_ms(ch);
+    int64_t phase = (int64_t)CHANNELS[ch].phase_s * 1000;
+    if (CHANNELS[ch].solar) {
+        phase = ((phase - (int64_t)SOLAR_OFFSET_S * 1000) % period + period) % period;
+    }
+    if (after_ms < phase) return phase;
+    return ((after_ms - phase) / period + 1) * period + phase;
+}
+
+uint32_t schedule_due(int64_t now_ms)
+{
+    uint32_t due = 0;
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        if (s_next_due_ms[ch] - EARLY_WAKE_MS <= now_ms) due |= CH_BIT(ch);
+    }
+    return due;
+}
+
+void schedule_advance(uint32_t ran, int64_t now_ms)
+{
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        if (!(ran & CH_BIT(ch))) continue;
+        // Slots missed while asleep are skipped, not made up
+        s_next_due_ms[ch] = next_slot(ch, now_ms + EARLY_WAKE_MS);
+        ESP_LOGD(TAG, "%s next due in %lld ms", CHANNELS[ch].name, s_next_due_ms[ch] - now_ms);
+    }
+}
+
+void schedule_set_period(channel_t ch, uint32_t period_ms)
+{
+    if (ch >= CH_COUNT) return;
+    s_period_ms[ch] = period_ms;
+    // schedule_sleep_ms() re-grids anything more than a period away
+}
+
+void schedule_set_stretch(uint8_t stretch)
+{
+    s_stretch = stretch;
+}
+
+int64_t schedule_sleep_ms(int64_t now_ms)
+{
+    int64_t next = INT64_MAX;
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        // Due but deferred: it runs on whichever wake comes next
+        if (s_next_due_ms[ch] <= now_ms) continue;
+
+        // A time sync can move the clock backwards; never wait more than a period
+        if (s_next_due_ms[ch] - now_ms > period_ms(ch)) {
+            s_next_due_ms[ch] = next_slot(ch, now_ms);
+        }
+        if (s_next_due_ms[ch] < next) next = s_next_due_ms[ch];
+    }
+
+    if (next == INT64_MAX) next = now_ms + period_ms(CH_DEPTH);
+
+    int64_t sleep_ms = next - now_ms;
+    return sleep_ms < MIN_SLEEP_MS ? MIN_SLEEP_MS : sleep_ms;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+
+// Sampling channels, each with its own cadence
+typedef enum {
+    CH_DEPTH,
+    CH_PROBE,  // salinity + temperature
+    CH_COLOR,
+    CH_SNAPSHOT, // JPEG picture for field debugging
+    CH_COUNT,
+} channel_t;
+
+#define CH_BIT(ch) (1u << (ch))
+
+// Site longitude in degrees, east positive; set for each buoy. Local solar
+// time runs 4 minutes per degree ahead of UTC. The daylight channels are
+// phased on it, and sensor.c sets it as TZ for localtime().
+#define SITE_LONGITUDE_DEG (-88.0)
+#define SOLAR_OFFSET_S     ((int32_t)(SITE_LONGITUDE_DEG * 240))
+
+// Returns a CH_BIT mask of the channels due at now_ms (wall clock, ms).
+uint32_t schedule_due(int64_t now_ms);
+
+// Marks the channels in `ran` as sampled and moves them to their next slot.
+void schedule_advance(uint32_t ran, int64_t now_ms);
+
+// Overrides a channel's period (0 restores the default). The channel's next
+// slot is pulled in if it is now further away than one new period.
+void schedule_set_period(channel_t ch, uint32_t period_ms);
+
+// Multiplies every channel's period, e.g. to save energy. 1 is normal.
+void schedule_set_stretch(uint8_t stretch);
+
+// Milliseconds from now_ms until the next channel is due. Channels already
+// overdue (deferred by the caller) are left for a later wake.
+int64_t schedule_sleep_ms(int64_t now_ms);
@@ -7,16 +7,27 @@
 #include "esp_timer.h"
 #include "data.h"
 #include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "driver/gpio.h"
 #include <time.h>
 #include "rom/ets_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
 
 #include "camera.h"
+#include "colorimetry.h"
+#include "driver.h"
+#include "adaptive.h"
+#include "battery.h"
 #include "logger.h"
-
-#define TRIG_PIN 5  // need to check these pins
-#define ECHO_PIN 18 // need to check these pins
+#include "power_policy.h"
+#include "schedule.h"
+#include "snapshot.h"
+#include "stages.h"
+#include "wake.h"
 
 static const char *TAG = "SENSOR";
 
@@ -24,24 +35,34 @@ static const char *TAG = "SENSOR";
 RTC_SLOW_ATTR uint16_t s_sequence_id = 1;
 RTC_SLOW_ATTR uint32_t s_minutes = 0; // increments each wake
 RTC_SLOW_ATTR uint16_t s_packet_num = 1;
+RTC_SLOW_ATTR power_level_t s_power_level = POWER_NORMAL;
 
 esp_err_t camera_init(void);
 esp_err_t camera_capture_color(uint8_t *r, uint8_t *g, uint8_t *b);
 
 static volatile bool s_upload_requested = false;
 
-const int wakeup_time_sec = 60;
-uint8_t receiver_mac[] = {0x34, 0x5F, 0x45, 0x37, 0x8C, 0xA4}; // need to fill this in correctly for each sensor
+const uint32_t measure_timeout_ms = 5000;
+// Wake pipeline: camera work on one core, radio and logger I/O on the other
+#define CAMERA_CORE 1
+#define RADIO_CORE  0
 
-static void setup_gpio(void)
-{
-    gpio_reset_pin(TRIG_PIN);
-    gpio_set_direction(TRIG_PIN, GPIO_MODE_OUTPUT);
-    gpio_set_level(TRIG_PIN, 0);
+#define EV_MEASURED    (1 << 0)
+#define EV_CAMERA_DONE (1 << 1)
+#define EV_LOGGED      (1 << 2)
+#define EV_LOG_MOUNTED (1 << 3)
 
-    gpio_reset_pin(ECHO_PIN);
-    gpio_set_direction(ECHO_PIN, GPIO_MODE_INPUT);
-}
+// Longest a wake spends sending snapshots once the records are out; the
+// rest goes on the boat's next pass
+#define IMAGE_UPLOAD_MS 15000
+
+static EventGroupHandle_t s_wake_events;
+static log_record_t s_rec;
+static log_record_t s_cam_rec;
+static power_plan_t s_plan;
+static uint32_t s_due;
+
+uint8_t receiver_mac[] = {0x34, 0x5F, 0x45, 0x37, 0x8C, 0xA4}; // need to fill this in correctly for each sensor
 
 static void recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *d, int len)
 {
@@ -57,6 +78,14 @@ static void recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *d, int
         return;
     }
 
+    if (len == sizeof(image_ack_packet_t))
+    {
+        image_ack_packet_t ack;
+        memcpy(&ack, d, sizeof(ack));
+        snapshot_on_ack(&ack);
+        return;
+    }
+
     if (len == sizeof(broadcast_type_t))
     {
         broadcast_packet_t broadcast;
@@ -82,6 +111,8 @@ static void init_esp_now(void)
     {
         ESP_ERROR_CHECK(err);
     }
+    // The camera task reads its calibration from NVS; it waits for this
+    colorimetry_nvs_ready();
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -112,9 +143,20 @@ static void send_one_record_as_packet(const log_record_t *rec, uint16_t idx, uin
     pkt.total = total;
     pkt.timestamp = rec->unix_s;
     pkt.data.depth_mm = rec->depth_mm;
+    pkt.data.depth_interval_ds = rec->depth_dt_ds;
+    pkt.data.battery_mv = rec->batt_mv;
+    pkt.data.soc_pct = rec->soc_pct;
+    pkt.data.power_level = rec->power_level;
     pkt.data.r = rec->r;
     pkt.data.g = rec->g;
     pkt.data.b = rec->b;
+    pkt.data.exposure_age_h = rec->expo_age_h;
+    memcpy(pkt.data.absorbance_mau, rec->abs_mau[0], sizeof(pkt.data.absorbance_mau));
+    if (rec->flags & 0x04)
+    {
+        pkt.data.temperature[0] = rec->temp_cc / 100.0f;
+        pkt.data.salinity[0] = rec->salinity_cppt / 100.0f;
+    }
 
     esp_err_t r = esp_now_send(receiver_mac, (uint8_t *)&pkt, sizeof(pkt));
     if (r != ESP_OK)
@@ -132,74 +174,105 @@ static bool time_is_valid(void)
     return (now > 1700000000); // ~late 2023; simple sanity
 }
 
-// is this the old code that needs to be replaced??
-static int16_t readDepthMm(void)
+// localtime() then gives local mean solar time at SITE_LONGITUDE_DEG. The
+// clock itself stays UTC, as the receiver sets it.
+static void set_solar_tz(void)
 {
-    gpio_set_level(TRIG_PIN, 0);
-    ets_delay_us(2);
-    gpio_set_level(TRIG_PIN, 1);
-    ets_delay_us(10);
-    gpio_set_level(TRIG_PIN, 0);
+    const int32_t west_s = -SOLAR_OFFSET_S; // POSIX offsets count west of Greenwich
+    const int32_t a = west_s < 0 ? -west_s : west_s;
+    char tz[24];
+    snprintf(tz, sizeof(tz), "LMT%c%ld:%02ld:%02ld", west_s < 0 ? '-' : '+',
+             (long)(a / 3600), (long)(a / 60 % 60), (long)(a % 60));
+    setenv("TZ", tz, 1);
+    tzset();
+}
 
-    const int64_t t0 = esp_timer_get_time();
-    while (gpio_get_level(ECHO_PIN) == 0)
+// Wall clock in ms; keeps counting through deep sleep even before a time sync
+static int64_t now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void camera_task(void *arg)
+{
+    (void)arg;
+    const sensor_driver_t *drivers[] = {&camera_driver};
+
+    if (s_due & CH_BIT(CH_COLOR))
     {
-        if (esp_timer_get_time() - t0 > 30000)
-            return -1;
+        stage_begin(STAGE_CAMERA);
+        wake_run(drivers, 1, &s_cam_rec, measure_timeout_ms);
+        stage_end(STAGE_CAMERA);
     }
 
-    const int64_t pulse_start = esp_timer_get_time();
-    while (gpio_get_level(ECHO_PIN) == 1)
+    // After the color capture, which wants the camera in its own mode. The
+    // picture goes on the log volume, so wait for the radio task to mount it.
+    if (s_due & CH_BIT(CH_SNAPSHOT))
     {
-        if (esp_timer_get_time() - pulse_start > 30000)
-            return -2;
+        xEventGroupWaitBits(s_wake_events, EV_LOG_MOUNTED, pdFALSE, pdTRUE, portMAX_DELAY);
+        stage_begin(STAGE_SNAPSHOT);
+        esp_err_t err = snapshot_take();
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Snapshot failed: %s", esp_err_to_name(err));
+        }
+        stage_end(STAGE_SNAPSHOT);
     }
-    const int64_t pulse_end = esp_timer_get_time();
-    const int64_t dur_us = pulse_end - pulse_start;
 
-    float mm = (float)dur_us * 0.343f / 2.0f;
-    return (int16_t)mm;
+    xEventGroupSetBits(s_wake_events, EV_CAMERA_DONE);
+    vTaskDelete(NULL);
 }
 
-void sensor(void)
+static void radio_task(void *arg)
 {
-    setup_gpio();
+    (void)arg;
+
+    stage_begin(STAGE_RADIO_UP);
     init_esp_now();
+    stage_end(STAGE_RADIO_UP);
+
+    stage_begin(STAGE_LOG_MOUNT);
     ESP_ERROR_CHECK(logger_init());
+    stage_end(STAGE_LOG_MOUNT);
+    xEventGroupSetBits(s_wake_events, EV_LOG_MOUNTED);
 
-    // Measure depth
-    int16_t depth_mm = readDepthMm();
+    // Nothing to write until every sensor has reported
+    xEventGroupWaitBits(s_wake_events, EV_MEASURED | EV_CAMERA_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
 
-    // Decide whether to do daily color (simple: once every 1440 minutes)
-    // bool do_color_today = (s_minutes % 1440u) == 0; // roughly once/day
-    bool do_color_today = true;
-    uint8_t r = 0, g = 0, b = 0;
-    uint8_t flags = 0;
-    if (time_is_valid())
-        flags |= 0x01;
+    stage_begin(STAGE_LOG_WRITE);
+    if (s_cam_rec.flags & 0x02)
+    {
+        s_rec.r = s_cam_rec.r;
+        s_rec.g = s_cam_rec.g;
+        s_rec.b = s_cam_rec.b;
+        s_rec.expo_age_h = s_cam_rec.expo_age_h;
+        s_rec.r_sd = s_cam_rec.r_sd;
+        s_rec.g_sd = s_cam_rec.g_sd;
+        s_rec.b_sd = s_cam_rec.b_sd;
+        s_rec.color_frames = s_cam_rec.color_frames;
+        memcpy(s_rec.abs_mau, s_cam_rec.abs_mau, sizeof(s_rec.abs_mau));
+        s_rec.flags |= 0x02;
+    }
 
-    if (do_color_today)
+    // Time may have been synced by the receiver while we were measuring
+    if (time_is_valid())
     {
-        if (camera_init() == ESP_OK && camera_capture_color(&r, &g, &b) == ESP_OK)
-        {
-            flags |= 0x02; // color_valid
-        }
+        s_rec.unix_s = (uint32_t)time(NULL);
+        s_rec.flags |= 0x01;
     }
 
     // Log record to flash
-    log_record_t rec = {
-        .unix_s = (uint32_t)(time_is_valid() ? time(NULL) : 0),
-        .depth_mm = depth_mm,
-        .r = r,
-        .g = g,
-        .b = b,
-        .flags = flags};
-
-    ESP_ERROR_CHECK(logger_append(&rec));
-    s_minutes++;
+    ESP_ERROR_CHECK(logger_append(&s_rec));
 
     // If boat asked, upload everything and then clear
-    if (s_upload_requested)
+    bool uploaded = false;
+    if (s_upload_requested && !s_plan.upload)
+    {
+        ESP_LOGI(TAG, "Upload deferred to save power");
+    }
+    else if (s_upload_requested)
     {
         uint32_t count = 0;
         logger_count(&count);
@@ -214,9 +287,97 @@ void sensor(void)
         // Start a new sequence/session
         s_sequence_id++;
         s_upload_requested = false;
+        uploaded = true;
+    }
+    stage_end(STAGE_LOG_WRITE);
+
+    // Pictures only after the numbers, and only with energy to spare
+    if (uploaded && s_plan.level <= POWER_SAVE)
+    {
+        stage_begin(STAGE_IMAGES);
+        snapshot_upload(receiver_mac, esp_timer_get_time() + (int64_t)IMAGE_UPLOAD_MS * 1000);
+        stage_end(STAGE_IMAGES);
+    }
+
+    xEventGroupSetBits(s_wake_events, EV_LOGGED);
+    vTaskDelete(NULL);
+}
+
+void sensor(void)
+{
+    s_wake_events = xEventGroupCreate();
+    s_rec = (log_record_t){.depth_mm = -1};
+    set_solar_tz();
+
+    xTaskCreatePinnedToCore(radio_task, "radio", 4096, NULL, 5, NULL, RADIO_CORE);
+
+    // Battery first: it shares ADC1 with the probe. The policy's sun window
+    // is in solar time, which is what localtime() gives under set_solar_tz().
+    int solar_hour = -1;
+    if (time_is_valid())
+    {
+        struct tm tm;
+        time_t t = time(NULL);
+        localtime_r(&t, &tm);
+        solar_hour = tm.tm_hour;
     }
+    uint16_t batt_mv = 0;
+    uint8_t soc_pct = 0;
+    if (battery_read(&batt_mv, &soc_pct) == ESP_OK)
+    {
+        s_rec.batt_mv = batt_mv;
+        s_rec.soc_pct = soc_pct;
+        s_plan = power_plan(soc_pct, solar_hour, s_power_level);
+    }
+    else
+    {
+        s_plan = power_plan(100, solar_hour, POWER_NORMAL);
+    }
+    s_power_level = s_plan.level;
+    s_rec.power_level = (uint8_t)s_plan.level;
+    schedule_set_stretch(s_plan.stretch);
+
+    const uint32_t due = schedule_due(now_ms()) & s_plan.channels;
+    s_due = due;
+    ESP_LOGI(TAG, "Due: depth=%d probe=%d color=%d snapshot=%d",
+             !!(due & CH_BIT(CH_DEPTH)), !!(due & CH_BIT(CH_PROBE)), !!(due & CH_BIT(CH_COLOR)),
+             !!(due & CH_BIT(CH_SNAPSHOT)));
+
+    if (!(due & (CH_BIT(CH_COLOR) | CH_BIT(CH_SNAPSHOT))) ||
+        xTaskCreatePinnedToCore(camera_task, "camera", 4096, NULL, 5, NULL, CAMERA_CORE) != pdPASS)
+    {
+        xEventGroupSetBits(s_wake_events, EV_CAMERA_DONE);
+    }
+
+    const sensor_driver_t *drivers[2];
+    size_t n_drivers = 0;
+    if (due & CH_BIT(CH_DEPTH))
+        drivers[n_drivers++] = &depth_driver;
+    if (due & CH_BIT(CH_PROBE))
+        drivers[n_drivers++] = &probe_driver;
+
+    stage_begin(STAGE_MEASURE);
+    wake_run(drivers, n_drivers, &s_rec, measure_timeout_ms);
+    stage_end(STAGE_MEASURE);
+
+    // Sample depth faster while it is changing, slower while it is calm
+    if (s_rec.flags & 0x08)
+    {
+        uint32_t dt_ms = 0;
+        schedule_set_period(CH_DEPTH, adaptive_depth_update(s_rec.depth_mm, now_ms(), &dt_ms));
+        s_rec.depth_dt_ds = (uint16_t)((dt_ms / 100 > UINT16_MAX) ? UINT16_MAX : dt_ms / 100);
+    }
+    xEventGroupSetBits(s_wake_events, EV_MEASURED);
+
+    // Join: don't sleep until the record is on flash
+    xEventGroupWaitBits(s_wake_events, EV_LOGGED, pdFALSE, pdTRUE, portMAX_DELAY);
+    s_minutes++;
+    stage_report();
+
+    schedule_advance(due, now_ms());
+    const int64_t sleep_ms = schedule_sleep_ms(now_ms());
 
-    ESP_LOGI(TAG, "Sleeping %d sec", wakeup_time_sec);
-    esp_sleep_enable_timer_wakeup((uint64_t)wakeup_time_sec * 1000000ULL);
+    ESP_LOGI(TAG, "Sleeping %lld ms", sleep_ms);
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_ms * 1000ULL);
     esp_deep_sleep_start();
 }
\ No newline at end of file
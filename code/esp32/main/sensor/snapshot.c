@@ -0,0 +1,230 @@
+#include "snapshot.h"
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "camera.h"
+#include "logger.h"
+
+static const char *TAG = "SNAPSHOT";
+
+// JPEG quality 1..100
+#define SNAPSHOT_QUALITY 80
+
+// Pictures kept on flash, sent or not. A VGA scene is 30-60 KB at quality
+// 80, so this is well inside the 1 MB storage partition with the log.
+#define SNAPSHOT_KEEP 8
+
+// Per chunk: how long to wait for the receiver's answer, and how many sends
+// without progress before giving up until the next pass
+#define ACK_TIMEOUT_MS 150
+#define CHUNK_TRIES    4
+
+// 8.3 names, the FAT volume has no long file names. Sent pictures are
+// renamed rather than deleted so the last SNAPSHOT_KEEP stay on the buoy.
+#define SNAP_NAME_FMT LOGGER_MOUNT_POINT "/IMG%05u.%s"
+#define SNAP_NEW      "JPG"
+#define SNAP_SENT     "SNT"
+#define SNAP_TMP_PATH LOGGER_MOUNT_POINT "/IMGNEW.TMP"
+
+#define SCAN_MAX 32
+_Static_assert(SNAPSHOT_KEEP < SCAN_MAX, "archive scan too small");
+
+typedef struct {
+    uint16_t id;
+    bool sent;
+} snap_entry_t;
+
+static QueueHandle_t s_acks;
+
+static void snap_path(char *buf, size_t len, uint16_t id, bool sent)
+{
+    snprintf(buf, len, SNAP_NAME_FMT, (unsigned)id, sent ? SNAP_SENT : SNAP_NEW);
+}
+
+// Stored pictures, oldest first
+static int scan(snap_entry_t *out, int max)
+{
+    DIR *d = opendir(LOGGER_MOUNT_POINT);
+    if (!d) return 0;
+
+    int n = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL && n < max) {
+        unsigned id;
+        char ext[4];
+        if (sscanf(e->d_name, "IMG%5u.%3s", &id, ext) != 2 || id > UINT16_MAX) continue;
+        const bool sent = strcasecmp(ext, SNAP_SENT) == 0;
+        if (!sent && strcasecmp(ext, SNAP_NEW) != 0) continue;
+
+        int i = n++;
+        for (; i > 0 && out[i - 1].id > id; i--) out[i] = out[i - 1];
+        out[i] = (snap_entry_t){.id = (uint16_t)id, .sent = sent};
+    }
+    closedir(d);
+    return n;
+}
+
+static esp_err_t file_sink(const uint8_t *data, size_t len, void *arg)
+{
+    return (fwrite(data, 1, len, (FILE *)arg) == len) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t snapshot_take(void)
+{
+    snap_entry_t list[SCAN_MAX];
+    const int n = scan(list, SCAN_MAX);
+    const uint16_t id = n ? (uint16_t)(list[n - 1].id + 1) : 1;
+
+    // Make room first; the new picture counts towards SNAPSHOT_KEEP
+    char path[32];
+    for (int i = 0; i < n - (SNAPSHOT_KEEP - 1); i++) {
+        snap_path(path, sizeof(path), list[i].id, list[i].sent);
+        if (remove(path) == 0) ESP_LOGI(TAG, "Dropped %s", path);
+    }
+
+    // Written under a temporary name so a reset mid-capture doesn't leave a
+    // truncated picture queued for upload
+    remove(SNAP_TMP_PATH);
+    FILE *f = fopen(SNAP_TMP_PATH, "wb");
+    if (!f) return ESP_FAIL;
+
+    esp_err_t err = camera_capture_jpeg(SNAPSHOT_QUALITY, file_sink, f);
+    const long size = ftell(f);
+    if (fclose(f) != 0 && err == ESP_OK) err = ESP_FAIL;
+    if (err == ESP_OK && size <= 0) err = ESP_ERR_INVALID_SIZE;
+
+    snap_path(path, sizeof(path), id, false);
+    if (err == ESP_OK && rename(SNAP_TMP_PATH, path) != 0) err = ESP_FAIL;
+    if (err != ESP_OK) {
+        remove(SNAP_TMP_PATH);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Stored %s, %ld bytes", path, size);
+    return ESP_OK;
+}
+
+void snapshot_on_ack(const image_ack_packet_t *ack)
+{
+    if (s_acks) xQueueSend(s_acks, ack, 0);
+}
+
+// Waits for the receiver's answer about this image; stale answers to
+// earlier sends are dropped
+static bool wait_ack(uint16_t id, uint16_t total, image_ack_packet_t *ack)
+{
+    const int64_t until = esp_timer_get_time() + (int64_t)ACK_TIMEOUT_MS * 1000;
+    for (;;) {
+        const int64_t left_us = until - esp_timer_get_time();
+        if (left_us <= 0) return false;
+        if (xQueueReceive(s_acks, ack, pdMS_TO_TICKS(left_us / 1000) + 1) != pdTRUE) return false;
+        if (ack->image_id == id && ack->total == total) return true;
+    }
+}
+
+// Stop-and-wait over the image's chunks, starting wherever the receiver
+// says it got to. *done is set once the receiver has all of it.
+static esp_err_t send_image(const uint8_t *peer, uint16_t id, int64_t deadline_us, bool *done)
+{
+    static image_chunk_packet_t pkt;
+    char path[32];
+    struct stat st;
+
+    *done = false;
+    snap_path(path, sizeof(path), id, false);
+    if (stat(path, &st) != 0) return ESP_FAIL;
+
+    const uint32_t chunks = ((uint32_t)st.st_size + IMAGE_CHUNK_BYTES - 1) / IMAGE_CHUNK_BYTES;
+    if (chunks == 0 || chunks > UINT16_MAX) {
+        ESP_LOGW(TAG, "%s: %ld bytes, not sending", path, (long)st.st_size);
+        *done = true;
+        return ESP_OK;
+    }
+    const uint16_t total = (uint16_t)chunks;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return ESP_FAIL;
+
+    esp_err_t err = ESP_OK;
+    uint16_t next = 0;
+    int tries = 0;
+    while (next < total) {
+        if (esp_timer_get_time() > deadline_us) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (tries++ >= CHUNK_TRIES) {
+            ESP_LOGW(TAG, "IMG%05u: no answer for chunk %u/%u", (unsigned)id, next, total);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.image_id = id;
+        pkt.chunk = next;
+        pkt.total = total;
+        pkt.timestamp = (st.st_mtime > 1700000000) ? (uint32_t)st.st_mtime : 0;
+        if (fseek(f, (long)next * IMAGE_CHUNK_BYTES, SEEK_SET) != 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        pkt.len = (uint16_t)fread(pkt.data, 1, IMAGE_CHUNK_BYTES, f);
+
+        if (esp_now_send(peer, (uint8_t *)&pkt, sizeof(pkt)) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        image_ack_packet_t ack;
+        if (!wait_ack(id, total, &ack)) continue;
+        if (ack.next != next) tries = 0;
+        next = (ack.next > total) ? total : ack.next;
+    }
+    fclose(f);
+
+    if (next >= total) *done = true;
+    return *done ? ESP_OK : err;
+}
+
+esp_err_t snapshot_upload(const uint8_t *peer, int64_t deadline_us)
+{
+    if (!peer) return ESP_ERR_INVALID_ARG;
+    if (!s_acks) {
+        s_acks = xQueueCreate(4, sizeof(image_ack_packet_t));
+        if (!s_acks) return ESP_ERR_NO_MEM;
+    }
+    xQueueReset(s_acks);
+
+    snap_entry_t list[SCAN_MAX];
+    const int n = scan(list, SCAN_MAX);
+    int sent = 0, pending = 0;
+    esp_err_t err = ESP_OK;
+
+    for (int i = 0; i < n; i++) {
+        if (list[i].sent) continue;
+        pending++;
+        if (err != ESP_OK) continue;
+
+        bool done = false;
+        err = send_image(peer, list[i].id, deadline_us, &done);
+        if (!done) continue;
+
+        char from[32], to[32];
+        snap_path(from, sizeof(from), list[i].id, false);
+        snap_path(to, sizeof(to), list[i].id, true);
+        rename(from, to);
+        sent++;
+    }
+
+    if (pending) ESP_LOGI(TAG, "Sent %d of %d snapshots", sent, pending);
+    return err;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "data.h"
+
+// Daily JPEG snapshots kept on the log volume for field debugging
+// (biofouling, placement) without retrieving the buoy.
+
+// Takes a snapshot and stores it, dropping the oldest beyond the last
+// SNAPSHOT_KEEP. The log volume must be mounted.
+esp_err_t snapshot_take(void);
+
+// Sends stored snapshots that the receiver doesn't have yet, oldest first,
+// until done or deadline_us (esp_timer time). Picks up where the receiver
+// says a previous pass stopped.
+esp_err_t snapshot_upload(const uint8_t *peer, int64_t deadline_us);
+
+// Feeds a receiver acknowledgement to snapshot_upload(); safe from the
+// ESP-NOW receive callback.
+void snapshot_on_ack(const image_ack_packet_t *ack);
@@ -0,0 +1,66 @@
+#include "stages.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "STAGES";
+
+static const char *const STAGE_NAMES[STAGE_COUNT] = {
+    [STAGE_RADIO_UP]  = "radio_up",
+    [STAGE_LOG_MOUNT] = "log_mount",
+    [STAGE_MEASURE]   = "measure",
+    [STAGE_CAMERA]    = "camera",
+    [STAGE_LOG_WRITE] = "log_write",
+    [STAGE_SNAPSHOT]  = "snapshot",
+    [STAGE_IMAGES]    = "images",
+};
+
+typedef struct {
+    int64_t begin_us;
+    int64_t end_us;
+    int8_t  core;
+} stage_time_t;
+
+// Each entry is written by exactly one task, and only read after the join
+static stage_time_t s_stages[STAGE_COUNT];
+
+void stage_begin(stage_t stage)
+{
+    if (stage >= STAGE_COUNT) return;
+    s_stages[stage].begin_us = esp_timer_get_time();
+    s_stages[stage].core = (int8_t)xPortGetCoreID();
+}
+
+void stage_end(stage_t stage)
+{
+    if (stage >= STAGE_COUNT) return;
+    s_stages[stage].end_us = esp_timer_get_time();
+}
+
+void stage_report(void)
+{
+    int64_t first = INT64_MAX, last = 0, serial = 0;
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const stage_time_t *st = &s_stages[i];
+        if (st->end_us == 0) continue;
+
+        if (st->begin_us < first) first = st->begin_us;
+        if (st->end_us > last) last = st->end_us;
+        serial += st->end_us - st->begin_us;
+    }
+    if (last == 0) return;
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const stage_time_t *st = &s_stages[i];
+        if (st->end_us == 0) continue;
+        ESP_LOGI(TAG, "%-10s core %d  %6lld .. %6lld ms (%lld ms)", STAGE_NAMES[i], st->core,
+                 (st->begin_us - first) / 1000, (st->end_us - first) / 1000,
+                 (st->end_us - st->begin_us) / 1000);
+    }
+
+    const int64_t wall = last - first;
+    ESP_LOGI(TAG, "Wall %lld ms, stages back to back %lld ms, overlap saved %lld ms",
+             wall / 1000, serial / 1000, (serial - wall) / 1000);
+}
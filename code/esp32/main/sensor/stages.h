@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+
+// Wake stages whose timing is recorded so the overlap between cores can be
+// measured. Each stage may be entered once per wake.
+typedef enum {
+    STAGE_RADIO_UP,   // Wi-Fi + ESP-NOW bring-up
+    STAGE_LOG_MOUNT,  // FAT mount
+    STAGE_MEASURE,    // depth + probe
+    STAGE_CAMERA,     // camera init, capture and ROI statistics
+    STAGE_LOG_WRITE,  // append record (and upload if asked)
+    STAGE_SNAPSHOT,   // camera re-init and JPEG to flash
+    STAGE_IMAGES,     // snapshot upload, after the records
+    STAGE_COUNT,
+} stage_t;
+
+void stage_begin(stage_t stage);
+void stage_end(stage_t stage);
+
+// Logs each stage's window and core, and how much wall time running them
+// concurrently saved compared with running them back to back.
+void stage_report(void);
@@ -0,0 +1,56 @@
+#include "wake.h"
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "WAKE";
+
+#define WAKE_MAX_DRIVERS 8
+
+esp_err_t wake_run(const sensor_driver_t *const *drivers, size_t count, log_record_t *rec, uint32_t timeout_ms)
+{
+    if (!drivers || !rec || count > WAKE_MAX_DRIVERS) return ESP_ERR_INVALID_ARG;
+
+    bool pending[WAKE_MAX_DRIVERS] = {0};
+    size_t remaining = 0;
+    const int64_t t0 = esp_timer_get_time();
+
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t err = drivers[i]->start();
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s: start failed: %s", drivers[i]->name, esp_err_to_name(err));
+            drivers[i]->power_down();
+            continue;
+        }
+        pending[i] = true;
+        remaining++;
+    }
+
+    const int64_t deadline = t0 + (int64_t)timeout_ms * 1000;
+    while (remaining > 0 && esp_timer_get_time() < deadline) {
+        for (size_t i = 0; i < count; i++) {
+            if (!pending[i] || !drivers[i]->poll()) continue;
+
+            esp_err_t err = drivers[i]->collect(rec);
+            drivers[i]->power_down();
+            pending[i] = false;
+            remaining--;
+
+            ESP_LOGI(TAG, "%s: %s after %lld ms", drivers[i]->name,
+                     err == ESP_OK ? "done" : esp_err_to_name(err),
+                     (esp_timer_get_time() - t0) / 1000);
+        }
+        if (remaining > 0) vTaskDelay(1);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!pending[i]) continue;
+        ESP_LOGW(TAG, "%s: timed out", drivers[i]->name);
+        drivers[i]->power_down();
+    }
+
+    ESP_LOGI(TAG, "Wake measurements took %lld ms", (esp_timer_get_time() - t0) / 1000);
+    return remaining == 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver.h"
+#include "logger.h"
+
+// Starts every driver at once and collects each one as it finishes, so a wake
+// lasts about as long as its slowest sensor. Drivers still running after
+// timeout_ms are powered down without collecting.
+esp_err_t wake_run(const sensor_driver_t *const *drivers, size_t count, log_record_t *rec, uint32_t timeout_ms);
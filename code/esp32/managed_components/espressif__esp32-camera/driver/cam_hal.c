@@ -262,6 +262,53 @@ void IRAM_ATTR ll_cam_send_event(cam_obj_t *cam, cam_event_t cam_event, BaseType
     }
 }
 
+static void cam_stream_finish(esp_err_t err)
+{
+    ll_cam_stop(cam_obj);
+    cam_obj->state = CAM_STATE_IDLE;
+    cam_obj->stream_err = err;
+    cam_obj->stream_armed = false;
+    xSemaphoreGive(cam_obj->stream_done);
+}
+
+//Streaming mode: hand each DMA half buffer to the callback instead of copying it into a frame
+static void cam_stream_event(cam_event_t cam_event, int *cnt)
+{
+    if (cam_event == CAM_VSYNC_EVENT) {
+        // frame ended before the caller got all the rows it asked for
+        cam_stream_finish(ESP_ERR_INVALID_SIZE);
+        return;
+    }
+
+    size_t len = ll_cam_memcpy(cam_obj, cam_obj->stream_buf,
+        &cam_obj->dma_buffer[(*cnt % cam_obj->dma_half_buffer_cnt) * cam_obj->dma_half_buffer_size],
+        cam_obj->dma_half_buffer_size);
+    (*cnt)++;
+
+    size_t line = (size_t)(cam_obj->width * cam_obj->fb_bytes_per_pixel);
+    camera_stream_block_t block = {
+        .data = cam_obj->stream_buf,
+        .len = len,
+        .offset = cam_obj->stream_len,
+        .row = cam_obj->stream_len / line,
+        .rows = len / line,
+        .width = cam_obj->width,
+        .height = cam_obj->height,
+    };
+    cam_obj->stream_len += len;
+
+    bool more = false;
+    xSemaphoreTake(cam_obj->stream_lock, portMAX_DELAY);
+    if (cam_obj->stream_cb) {
+        more = cam_obj->stream_cb(&block, cam_obj->stream_arg);
+    }
+    xSemaphoreGive(cam_obj->stream_lock);
+
+    if (!more || cam_obj->stream_len >= cam_obj->stream_end) {
+        cam_stream_finish(ESP_OK);
+    }
+}
+
 //Copy fram from DMA dma_buffer to fram dma_buffer
 static void cam_task(void *arg)
 {
@@ -278,7 +325,14 @@ static void cam_task(void *arg)
         switch (cam_obj->state) {
 
             case CAM_STATE_IDLE: {
-                if (cam_event == CAM_VSYNC_EVENT) {
+                if (cam_event == CAM_VSYNC_EVENT && cam_obj->frame_cnt == 0) {
+                    if (cam_obj->stream_armed && ll_cam_start(cam_obj, 0)) {
+                        ll_cam_do_vsync(cam_obj);
+                        cam_obj->stream_len = 0;
+                        cam_obj->state = CAM_STATE_READ_BUF;
+                    }
+                    cnt = 0;
+                } else if (cam_event == CAM_VSYNC_EVENT) {
                     //DBG_PIN_SET(1);
                     if(cam_start_frame(&frame_pos)){
                         cam_obj->frames[frame_pos].fb.len = 0;
@@ -290,6 +344,10 @@ static void cam_task(void *arg)
             break;
 
             case CAM_STATE_READ_BUF: {
+                if (cam_obj->frame_cnt == 0) {
+                    cam_stream_event(cam_event, &cnt);
+                    break;
+                }
                 camera_fb_t * frame_buffer_event = &cam_obj->frames[frame_pos].fb;
                 size_t pixels_per_dma = (cam_obj->dma_half_buffer_size * cam_obj->fb_bytes_per_pixel) / (cam_obj->dma_bytes_per_item * cam_obj->in_bytes_per_pixel);
 
@@ -473,8 +531,10 @@ static esp_err_t cam_dma_config(const camera_config_t *config)
     cam_obj->dma_buffer = NULL;
     cam_obj->dma = NULL;
 
-    cam_obj->frames = (cam_frame_t *)heap_caps_aligned_calloc(alignof(cam_frame_t), 1, cam_obj->frame_cnt * sizeof(cam_frame_t), MALLOC_CAP_DEFAULT);
-    CAM_CHECK(cam_obj->frames != NULL, "frames malloc failed", ESP_FAIL);
+    if (cam_obj->frame_cnt) {
+        cam_obj->frames = (cam_frame_t *)heap_caps_aligned_calloc(alignof(cam_frame_t), 1, cam_obj->frame_cnt * sizeof(cam_frame_t), MALLOC_CAP_DEFAULT);
+        CAM_CHECK(cam_obj->frames != NULL, "frames malloc failed", ESP_FAIL);
+    }
 
     uint8_t dma_align = 0;
     size_t fb_size = cam_obj->fb_size;
@@ -530,6 +590,16 @@ static esp_err_t cam_dma_config(const camera_config_t *config)
         CAM_CHECK(cam_obj->dma != NULL, "dma malloc failed", ESP_FAIL);
     }
 
+    if (!cam_obj->frame_cnt) {
+        // Streaming only: a single internal RAM block for the callback, no frame buffers
+        ESP_LOGI(TAG, "Streaming mode, %d Byte block buffer", (int) cam_obj->dma_half_buffer_size);
+        cam_obj->stream_buf = (uint8_t *)heap_caps_malloc(cam_obj->dma_half_buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        CAM_CHECK(cam_obj->stream_buf != NULL, "stream buffer malloc failed", ESP_FAIL);
+        cam_obj->stream_lock = xSemaphoreCreateMutex();
+        cam_obj->stream_done = xSemaphoreCreateBinary();
+        CAM_CHECK(cam_obj->stream_lock != NULL && cam_obj->stream_done != NULL, "stream semaphore create failed", ESP_FAIL);
+    }
+
     return ESP_OK;
 }
 
@@ -574,7 +644,8 @@ esp_err_t cam_config(const camera_config_t *config, framesize_t frame_size, uint
     
     cam_obj->jpeg_mode = config->pixel_format == PIXFORMAT_JPEG;
 #if CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
-    cam_obj->psram_mode = g_psram_dma_mode;
+    // streaming has no frame buffer for PSRAM DMA to land in
+    cam_obj->psram_mode = g_psram_dma_mode && config->fb_count > 0;
 #else
     cam_obj->psram_mode = false;
 #endif
@@ -609,6 +680,9 @@ esp_err_t cam_config(const camera_config_t *config, framesize_t frame_size, uint
     if (config->grab_mode == CAMERA_GRAB_LATEST && cam_obj->frame_cnt > 1) {
         frame_buffer_queue_len = cam_obj->frame_cnt - 1;
     }
+    if (frame_buffer_queue_len == 0) {
+        frame_buffer_queue_len = 1;
+    }
     cam_obj->frame_buffer_queue = xQueueCreate(frame_buffer_queue_len, sizeof(camera_fb_t*));
     CAM_CHECK_GOTO(cam_obj->frame_buffer_queue != NULL, "frame_buffer_queue create failed", err);
 
@@ -657,6 +731,15 @@ esp_err_t cam_deinit(void)
     if (cam_obj->dma_buffer) {
         free(cam_obj->dma_buffer);
     }
+    if (cam_obj->stream_buf) {
+        free(cam_obj->stream_buf);
+    }
+    if (cam_obj->stream_lock) {
+        vSemaphoreDelete(cam_obj->stream_lock);
+    }
+    if (cam_obj->stream_done) {
+        vSemaphoreDelete(cam_obj->stream_done);
+    }
     if (cam_obj->frames) {
         for (int x = 0; x < cam_obj->frame_cnt; x++) {
             free(cam_obj->frames[x].fb.buf - cam_obj->frames[x].fb_offset);
@@ -697,6 +780,11 @@ camera_fb_t *cam_take(TickType_t timeout)
     /* throttle repeated NO-EOI warnings */
     static uint16_t warn_eoi_miss_cnt = 0;
 
+    if (cam_obj->frame_cnt == 0) {
+        ESP_LOGW(TAG, "No frame buffers in streaming mode, use esp_camera_stream()");
+        return NULL;
+    }
+
     for (;;)
     {
         TickType_t elapsed = xTaskGetTickCount() - start; /* TickType_t is unsigned so rollover is safe */
@@ -785,6 +873,42 @@ skip_eoi_check:
     }
 }
 
+esp_err_t cam_stream(camera_stream_cb_t cb, void *arg, uint16_t last_row, uint32_t timeout_ms)
+{
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!cam_obj || cam_obj->frame_cnt != 0 || cam_obj->jpeg_mode) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (last_row >= cam_obj->height) {
+        last_row = cam_obj->height - 1;
+    }
+
+    /* drop a completion left over from a stream that timed out */
+    xSemaphoreTake(cam_obj->stream_done, 0);
+
+    xSemaphoreTake(cam_obj->stream_lock, portMAX_DELAY);
+    cam_obj->stream_cb = cb;
+    cam_obj->stream_arg = arg;
+    cam_obj->stream_end = (size_t)(last_row + 1) * (size_t)(cam_obj->width * cam_obj->fb_bytes_per_pixel);
+    cam_obj->stream_err = ESP_ERR_TIMEOUT;
+    cam_obj->stream_armed = true;
+    xSemaphoreGive(cam_obj->stream_lock);
+
+    esp_err_t err = ESP_ERR_TIMEOUT;
+    if (xSemaphoreTake(cam_obj->stream_done, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
+        err = cam_obj->stream_err;
+    }
+
+    /* once the lock is ours the camera task can't be inside cb or call it again */
+    xSemaphoreTake(cam_obj->stream_lock, portMAX_DELAY);
+    cam_obj->stream_cb = NULL;
+    cam_obj->stream_armed = false;
+    xSemaphoreGive(cam_obj->stream_lock);
+    return err;
+}
+
 void cam_give(camera_fb_t *dma_buffer)
 {
     for (int x = 0; x < cam_obj->frame_cnt; x++) {
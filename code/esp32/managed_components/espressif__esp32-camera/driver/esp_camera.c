@@ -27,6 +27,7 @@
 #include "cam_hal.h"
 #include "esp_camera.h"
 #include "xclk.h"
+#include "esp_rom_crc.h"
 #if CONFIG_OV2640_SUPPORT
 #include "ov2640.h"
 #endif
@@ -164,10 +165,10 @@ static const sensor_func_t g_sensors[] = {
 #endif
 };
 
-static esp_err_t camera_probe(const camera_config_t *config, camera_model_t *out_camera_model)
+// Allocates the driver state, starts XCLK and SCCB and pulses the power-down/reset lines
+static esp_err_t camera_bus_init(const camera_config_t *config)
 {
     esp_err_t ret = ESP_OK;
-    *out_camera_model = CAMERA_NONE;
     if (s_state != NULL) {
         return ESP_ERR_INVALID_STATE;
     }
@@ -221,6 +222,22 @@ static esp_err_t camera_probe(const camera_config_t *config, camera_model_t *out
         gpio_set_level(config->pin_reset, 1);
         vTaskDelay(10 / portTICK_PERIOD_MS);
     }
+    return ESP_OK;
+
+err :
+    CAMERA_DISABLE_OUT_CLOCK();
+    return ret;
+}
+
+static esp_err_t camera_probe(const camera_config_t *config, camera_model_t *out_camera_model)
+{
+    esp_err_t ret = ESP_OK;
+    *out_camera_model = CAMERA_NONE;
+
+    ret = camera_bus_init(config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
     ESP_LOGD(TAG, "Searching for camera address");
     vTaskDelay(10 / portTICK_PERIOD_MS);
@@ -548,3 +565,296 @@ bool esp_camera_get_psram_mode(void)
 {
     return cam_get_psram_mode();
 }
+
+/*
+ * Register snapshots
+ *
+ * While recording, every SCCB write to the sensor lands in the snapshot:
+ * first-write order is kept, values are overwritten with the last write.
+ * Writes to the page register only switch the page the next entries go to.
+ */
+static camera_snapshot_t *s_snap_rec = NULL;
+static uint8_t s_snap_page = 0;
+static bool s_snap_supported = false;
+static bool s_snap_overflow = false;
+
+// Page select register of each sensor the snapshot code knows; add sensors here once checked
+static bool snapshot_page_reg(uint16_t pid, uint8_t *page_reg)
+{
+    switch (pid) {
+    case OV2640_PID:
+        *page_reg = 0xFF; // BANK_SEL
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Soft-resets the sensor so the replay starts from power-on defaults. The
+// recorder folds reset pulses into their last values, so registers only the
+// full init's tables touch would otherwise keep whatever a later init in
+// another mode (JPEG, say) left in them.
+static esp_err_t snapshot_soft_reset(const camera_snapshot_t *snap)
+{
+    switch (snap->pid) {
+    case OV2640_PID:
+        // BANK_SEL = BANK_SENSOR, COM7 = COM7_SRST; same settle as ov2640 reset()
+        if (SCCB_Write(snap->slv_addr, 0xFF, 0x01) != 0 || SCCB_Write(snap->slv_addr, 0x12, 0x80) != 0) {
+            return ESP_FAIL;
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+        return ESP_OK;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static void snapshot_write_hook(uint8_t slv_addr, uint8_t reg, uint8_t data)
+{
+    camera_snapshot_t *snap = s_snap_rec;
+    if (!snap || !s_state || slv_addr != s_state->sensor.slv_addr) {
+        return;
+    }
+
+    // The sensor is identified before its first register write
+    if (snap->pid == 0) {
+        snap->pid = s_state->sensor.id.PID;
+        snap->slv_addr = slv_addr;
+        s_snap_supported = snapshot_page_reg(snap->pid, &snap->page_reg);
+    }
+    if (!s_snap_supported) {
+        return;
+    }
+    if (snap->page_reg && reg == snap->page_reg) {
+        s_snap_page = data;
+        return;
+    }
+
+    for (uint16_t i = 0; i < snap->count; i++) {
+        if (snap->regs[i].page == s_snap_page && snap->regs[i].reg == reg) {
+            snap->regs[i].val = data;
+            return;
+        }
+    }
+    if (snap->count >= CAMERA_SNAPSHOT_MAX_REGS) {
+        s_snap_overflow = true;
+        return;
+    }
+    snap->regs[snap->count].page = s_snap_page;
+    snap->regs[snap->count].reg = reg;
+    snap->regs[snap->count].val = data;
+    snap->count++;
+}
+
+static uint32_t snapshot_crc(const camera_snapshot_t *snap)
+{
+    const uint8_t *start = (const uint8_t *)&snap->pid;
+    const uint8_t *end = (const uint8_t *)&snap->regs[snap->count];
+    return esp_rom_crc32_le(0, start, end - start);
+}
+
+esp_err_t esp_camera_snapshot_record(camera_snapshot_t *snap)
+{
+    if (!snap) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(snap, 0, sizeof(*snap));
+    s_snap_page = 0;
+    s_snap_supported = false;
+    s_snap_overflow = false;
+    s_snap_rec = snap;
+    SCCB_Set_Write_Hook(snapshot_write_hook);
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_snapshot_finish(void)
+{
+    camera_snapshot_t *snap = s_snap_rec;
+    SCCB_Set_Write_Hook(NULL);
+    s_snap_rec = NULL;
+
+    if (!snap || !s_state) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_snap_supported) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (s_snap_overflow) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    snap->burst = CAMERA_SNAPSHOT_BURST_UNTESTED;
+    snap->crc = snapshot_crc(snap);
+    snap->magic = CAMERA_SNAPSHOT_MAGIC;
+    ESP_LOGI(TAG, "Snapshot of %u registers for PID 0x%02x", snap->count, snap->pid);
+    return ESP_OK;
+}
+
+bool esp_camera_snapshot_valid(const camera_snapshot_t *snap)
+{
+    return snap && snap->magic == CAMERA_SNAPSHOT_MAGIC && snap->count <= CAMERA_SNAPSHOT_MAX_REGS
+        && snap->crc == snapshot_crc(snap);
+}
+
+#define SNAPSHOT_BURST_MAX 32
+
+// Number of entries from i on that can go out as one sequential write
+static uint16_t snapshot_run_len(const camera_snapshot_t *snap, uint16_t i, bool burst)
+{
+    uint16_t n = 1;
+    if (!burst) {
+        return n;
+    }
+    while (i + n < snap->count && n < SNAPSHOT_BURST_MAX
+           && snap->regs[i + n].page == snap->regs[i].page
+           && snap->regs[i + n].reg == snap->regs[i].reg + n) {
+        n++;
+    }
+    return n;
+}
+
+static esp_err_t snapshot_restore(const camera_snapshot_t *snap, bool burst)
+{
+    uint8_t buf[SNAPSHOT_BURST_MAX];
+    int page = -1;
+
+    for (uint16_t i = 0; i < snap->count; ) {
+        const camera_snapshot_reg_t *r = &snap->regs[i];
+        if (snap->page_reg && r->page != page) {
+            if (SCCB_Write(snap->slv_addr, snap->page_reg, r->page) != 0) {
+                return ESP_FAIL;
+            }
+            page = r->page;
+        }
+
+        uint16_t n = snapshot_run_len(snap, i, burst);
+        int ret;
+        if (n == 1) {
+            ret = SCCB_Write(snap->slv_addr, r->reg, r->val);
+        } else {
+            for (uint16_t k = 0; k < n; k++) {
+                buf[k] = snap->regs[i + k].val;
+            }
+            ret = SCCB_Write_Burst(snap->slv_addr, r->reg, buf, n);
+        }
+        if (ret != 0) {
+            return ESP_FAIL;
+        }
+        i += n;
+    }
+    return ESP_OK;
+}
+
+// Read back the last register of every sequential write; a mismatch means no auto-increment
+static bool snapshot_bursts_landed(const camera_snapshot_t *snap)
+{
+    for (uint16_t i = 0; i < snap->count; ) {
+        uint16_t n = snapshot_run_len(snap, i, true);
+        if (n > 1) {
+            const camera_snapshot_reg_t *last = &snap->regs[i + n - 1];
+            if (snap->page_reg) {
+                SCCB_Write(snap->slv_addr, snap->page_reg, last->page);
+            }
+            if (SCCB_Read(snap->slv_addr, last->reg) != last->val) {
+                return false;
+            }
+        }
+        i += n;
+    }
+    return true;
+}
+
+esp_err_t esp_camera_init_from_snapshot(const camera_config_t *config, camera_snapshot_t *snap)
+{
+    if (!config || !esp_camera_snapshot_valid(snap)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err;
+    s_saved_config = *config;
+    err = cam_init(config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Camera init failed with error 0x%x", err);
+        return err;
+    }
+
+    err = camera_bus_init(config);
+    if (err != ESP_OK) {
+        goto fail;
+    }
+
+    // Only the recorded address and sensor are tried, and the sensor gets a
+    // soft reset rather than the full table upload
+    camera_model_t camera_model = CAMERA_NONE;
+    if (SCCB_Probe(snap->slv_addr) == ESP_OK) {
+        s_state->sensor.slv_addr = snap->slv_addr;
+        s_state->sensor.xclk_freq_hz = config->xclk_freq_hz;
+        sensor_id_t *id = &s_state->sensor.id;
+        for (size_t i = 0; i < sizeof(g_sensors) / sizeof(sensor_func_t); i++) {
+            if (g_sensors[i].detect(snap->slv_addr, id) && id->PID == snap->pid) {
+                camera_sensor_info_t *info = esp_camera_sensor_get_info(id);
+                if (info) {
+                    camera_model = info->model;
+                    g_sensors[i].init(&s_state->sensor);
+                }
+                break;
+            }
+        }
+    }
+    if (camera_model == CAMERA_NONE) {
+        ESP_LOGW(TAG, "Snapshot sensor PID 0x%02x not found at 0x%02x", snap->pid, snap->slv_addr);
+        err = ESP_ERR_CAMERA_NOT_DETECTED;
+        goto fail;
+    }
+
+    err = snapshot_soft_reset(snap);
+    if (err == ESP_OK) {
+        err = snapshot_restore(snap, snap->burst != CAMERA_SNAPSHOT_BURST_BAD);
+    }
+    if (err == ESP_OK && snap->burst == CAMERA_SNAPSHOT_BURST_UNTESTED) {
+        if (snapshot_bursts_landed(snap)) {
+            snap->burst = CAMERA_SNAPSHOT_BURST_OK;
+        } else {
+            ESP_LOGW(TAG, "Sensor doesn't take sequential writes, restoring one register at a time");
+            snap->burst = CAMERA_SNAPSHOT_BURST_BAD;
+            err = snapshot_restore(snap, false);
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Snapshot restore failed");
+        goto fail;
+    }
+
+    framesize_t frame_size = (framesize_t) config->frame_size;
+    pixformat_t pix_format = (pixformat_t) config->pixel_format;
+    if (frame_size > camera_sensor[camera_model].max_size) {
+        frame_size = camera_sensor[camera_model].max_size;
+    }
+
+    err = cam_config(config, frame_size, s_state->sensor.id.PID);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Camera config failed with error 0x%x", err);
+        goto fail;
+    }
+
+    // Frame size and format are already in the restored registers
+    s_state->sensor.status.framesize = frame_size;
+    s_state->sensor.pixformat = pix_format;
+    s_state->sensor.init_status(&s_state->sensor);
+
+    cam_start();
+
+    return ESP_OK;
+
+fail:
+    esp_camera_deinit();
+    return err;
+}
+
+esp_err_t esp_camera_stream(camera_stream_cb_t cb, void *arg, uint16_t last_row, uint32_t timeout_ms)
+{
+    if (s_state == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return cam_stream(cb, arg, last_row, timeout_ms);
+}
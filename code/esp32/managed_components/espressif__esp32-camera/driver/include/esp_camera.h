@@ -147,7 +147,7 @@ typedef struct {
     framesize_t frame_size;         /*!< Size of the output image: FRAMESIZE_ + QVGA|CIF|VGA|SVGA|XGA|SXGA|UXGA  */
 
     int jpeg_quality;               /*!< Quality of JPEG output. 0-63 lower means higher quality  */
-    size_t fb_count;                /*!< Number of frame buffers to be allocated. If more than one, then each frame will be acquired (double speed)  */
+    size_t fb_count;                /*!< Number of frame buffers to be allocated. If more than one, then each frame will be acquired (double speed). 0 = streaming only, see esp_camera_stream()  */
     camera_fb_location_t fb_location; /*!< The location where the frame buffer will be allocated */
     camera_grab_mode_t grab_mode;   /*!< When buffers should be filled */
 #if CONFIG_CAMERA_CONVERTER_ENABLED
@@ -169,6 +169,71 @@ typedef struct {
     struct timeval timestamp;   /*!< Timestamp since boot of the first DMA buffer of the frame */
 } camera_fb_t;
 
+/**
+ * @brief Block of pixel data handed to a streaming callback
+ *
+ * Blocks are cut at DMA EOF boundaries, which always hold whole lines in
+ * RGB/YUV modes.
+ */
+typedef struct {
+    const uint8_t * data;       /*!< Pixel data, only valid during the callback */
+    size_t len;                 /*!< Length of data in bytes */
+    size_t offset;              /*!< Byte offset of data from the start of the frame */
+    uint16_t row;               /*!< Frame row of the first byte of data */
+    uint16_t rows;              /*!< Number of whole rows in data */
+    uint16_t width;             /*!< Frame width in pixels */
+    uint16_t height;            /*!< Frame height in pixels */
+} camera_stream_block_t;
+
+/**
+ * @brief Streaming callback, runs in the camera task
+ *
+ * @param block Block of the frame that just arrived
+ * @param arg   User argument passed to esp_camera_stream()
+ *
+ * @return true to keep receiving blocks, false to stop the frame here
+ */
+typedef bool (*camera_stream_cb_t)(const camera_stream_block_t *block, void *arg);
+
+#define CAMERA_SNAPSHOT_MAGIC    0x504E5343  /* "CSNP" */
+#define CAMERA_SNAPSHOT_MAX_REGS 512
+
+/**
+ * @brief Whether sequential SCCB writes have been checked against the sensor
+ */
+typedef enum {
+    CAMERA_SNAPSHOT_BURST_UNTESTED = 0,
+    CAMERA_SNAPSHOT_BURST_OK,
+    CAMERA_SNAPSHOT_BURST_BAD,
+} camera_snapshot_burst_t;
+
+/**
+ * @brief One sensor register in a snapshot
+ */
+typedef struct {
+    uint8_t page;               /*!< Value of the sensor's page/bank register, 0 if it has none */
+    uint8_t reg;                /*!< Register address */
+    uint8_t val;                /*!< Last value written */
+} camera_snapshot_reg_t;
+
+/**
+ * @brief Sensor register state recorded during a full esp_camera_init()
+ *
+ * Registers are kept in the order they were first written, with the last
+ * value written to each. Small enough to live in RTC memory across deep sleep.
+ */
+typedef struct {
+    uint32_t magic;             /*!< CAMERA_SNAPSHOT_MAGIC once sealed */
+    uint8_t burst;              /*!< camera_snapshot_burst_t, updated on restore */
+    uint8_t reserved[3];
+    uint32_t crc;               /*!< CRC32 from pid to the last register */
+    uint16_t pid;               /*!< Sensor PID the snapshot belongs to */
+    uint8_t slv_addr;           /*!< SCCB address of the sensor */
+    uint8_t page_reg;           /*!< Page select register, 0 if the sensor has none */
+    uint16_t count;             /*!< Number of registers in regs */
+    camera_snapshot_reg_t regs[CAMERA_SNAPSHOT_MAX_REGS];
+} camera_snapshot_t;
+
 #define ESP_ERR_CAMERA_BASE 0x20000
 #define ESP_ERR_CAMERA_NOT_DETECTED             (ESP_ERR_CAMERA_BASE + 1)
 #define ESP_ERR_CAMERA_FAILED_TO_SET_FRAME_SIZE (ESP_ERR_CAMERA_BASE + 2)
@@ -274,6 +339,74 @@ esp_err_t esp_camera_reconfigure(const camera_config_t *config);
  */
 bool esp_camera_get_psram_mode(void);
 
+/**
+ * @brief Stream one frame through a callback instead of a frame buffer.
+ *
+ * Only available when the camera was initialized with fb_count = 0; no frame
+ * buffer is allocated then and DMA blocks are handed to the callback as they
+ * arrive. Capture stops after the block containing last_row, or earlier if
+ * the callback returns false.
+ *
+ * @param cb          Called for each block of the frame, in order
+ * @param arg         User argument for cb
+ * @param last_row    Last frame row the caller needs
+ * @param timeout_ms  How long to wait for the frame
+ * @return
+ * - ESP_OK when the frame was streamed up to last_row or stopped by cb
+ * - ESP_ERR_INVALID_ARG if cb is NULL
+ * - ESP_ERR_INVALID_STATE if the camera is not initialized for streaming
+ * - ESP_ERR_INVALID_SIZE if the frame ended before last_row
+ * - ESP_ERR_TIMEOUT if no frame arrived in time
+ */
+esp_err_t esp_camera_stream(camera_stream_cb_t cb, void *arg, uint16_t last_row, uint32_t timeout_ms);
+
+/**
+ * @brief Record every sensor register write into snap until esp_camera_snapshot_finish().
+ *
+ * Call before esp_camera_init(), then apply any further sensor settings
+ * that should be part of the snapshot before finishing it.
+ *
+ * @param snap  Snapshot to fill, usually in RTC memory
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if snap is NULL
+ */
+esp_err_t esp_camera_snapshot_record(camera_snapshot_t *snap);
+
+/**
+ * @brief Stop recording and seal the snapshot.
+ *
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if nothing was being recorded or the camera is not initialized
+ * - ESP_ERR_NOT_SUPPORTED if the sensor's register layout isn't known to the snapshot code
+ * - ESP_ERR_NO_MEM if more than CAMERA_SNAPSHOT_MAX_REGS registers were written
+ */
+esp_err_t esp_camera_snapshot_finish(void);
+
+/**
+ * @brief Check the magic and CRC of a snapshot
+ */
+bool esp_camera_snapshot_valid(const camera_snapshot_t *snap);
+
+/**
+ * @brief Initialize the camera from a snapshot instead of probing the sensor and uploading its tables.
+ *
+ * The sensor at snap->slv_addr is identified and soft-reset, so registers
+ * the snapshot doesn't cover are back at their defaults whatever ran since
+ * it was recorded. Its registers are then written back with sequential SCCB writes where the snapshot has runs of
+ * consecutive registers. The first restore reads back the end of each run;
+ * if the sensor doesn't auto-increment, snap->burst is set to
+ * CAMERA_SNAPSHOT_BURST_BAD and single writes are used from then on.
+ *
+ * @param config  Same configuration the snapshot was recorded with
+ * @param snap    Valid snapshot
+ * @return
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the snapshot is not valid
+ * - ESP_ERR_CAMERA_NOT_DETECTED if the recorded sensor is not found
+ * - Propagated error from the camera interface setup
+ */
+esp_err_t esp_camera_init_from_snapshot(const camera_config_t *config, camera_snapshot_t *snap);
+
 
 #ifdef __cplusplus
 }
@@ -59,6 +59,8 @@ void cam_give_all(void);
 
 bool cam_get_available_frames(void);
 
+esp_err_t cam_stream(camera_stream_cb_t cb, void *arg, uint16_t last_row, uint32_t timeout_ms);
+
 void cam_set_psram_mode(bool enable);
 bool cam_get_psram_mode(void);
 
@@ -9,12 +9,20 @@
 #ifndef __SCCB_H__
 #define __SCCB_H__
 #include <stdint.h>
+#include <stddef.h>
+
+/* Called after every successful SCCB_Write(), used to record register snapshots */
+typedef void (*sccb_write_hook_t)(uint8_t slv_addr, uint8_t reg, uint8_t data);
+
 int SCCB_Init(int pin_sda, int pin_scl);
 int SCCB_Use_Port(int sccb_i2c_port);
 int SCCB_Deinit(void);
 int SCCB_Probe(uint8_t slv_addr);
 uint8_t SCCB_Read(uint8_t slv_addr, uint8_t reg);
 int SCCB_Write(uint8_t slv_addr, uint8_t reg, uint8_t data);
+/* Sequential write of len registers from reg upwards in one transaction; relies on the sensor auto-incrementing */
+int SCCB_Write_Burst(uint8_t slv_addr, uint8_t reg, const uint8_t *data, size_t len);
+void SCCB_Set_Write_Hook(sccb_write_hook_t hook);
 uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg);
 int SCCB_Write16(uint8_t slv_addr, uint16_t reg, uint8_t data);
 uint16_t SCCB_Read_Addr16_Val16(uint8_t slv_addr, uint16_t reg);
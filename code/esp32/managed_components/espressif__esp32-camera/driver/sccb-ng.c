@@ -57,6 +57,7 @@ typedef struct
 
 static device_t devices[MAX_DEVICES];
 static uint8_t device_count = 0;
+static sccb_write_hook_t write_hook = NULL;
 static int sccb_i2c_port;
 static bool sccb_owns_i2c_port;
 
@@ -253,10 +254,38 @@ int SCCB_Write(uint8_t slv_addr, uint8_t reg, uint8_t data)
     {
         ESP_LOGE(TAG, "SCCB_Write Failed addr:0x%02x, reg:0x%02x, data:0x%02x, ret:%d", slv_addr, reg, data, ret);
     }
+    else if (write_hook)
+    {
+        write_hook(slv_addr, reg, data);
+    }
+
+    return ret == ESP_OK ? 0 : -1;
+}
+
+int SCCB_Write_Burst(uint8_t slv_addr, uint8_t reg, const uint8_t *data, size_t len)
+{
+    i2c_master_dev_handle_t dev_handle = *(get_handle_from_address(slv_addr));
+
+    i2c_master_transmit_multi_buffer_info_t bufs[2] = {
+        {.write_buffer = &reg, .buffer_size = 1},
+        {.write_buffer = (uint8_t *)data, .buffer_size = len},
+    };
+
+    esp_err_t ret = i2c_master_multi_buffer_transmit(dev_handle, bufs, 2, TIMEOUT_MS);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "SCCB_Write_Burst Failed addr:0x%02x, reg:0x%02x, len:%u, ret:%d", slv_addr, reg, (unsigned)len, ret);
+    }
 
     return ret == ESP_OK ? 0 : -1;
 }
 
+void SCCB_Set_Write_Hook(sccb_write_hook_t hook)
+{
+    write_hook = hook;
+}
+
 uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg)
 {
     i2c_master_dev_handle_t dev_handle = *(get_handle_from_address(slv_addr));
@@ -129,6 +129,8 @@ uint8_t SCCB_Read(uint8_t slv_addr, uint8_t reg)
     return data;
 }
 
+static sccb_write_hook_t write_hook = NULL;
+
 int SCCB_Write(uint8_t slv_addr, uint8_t reg, uint8_t data)
 {
     esp_err_t ret = ESP_FAIL;
@@ -142,10 +144,34 @@ int SCCB_Write(uint8_t slv_addr, uint8_t reg, uint8_t data)
     i2c_cmd_link_delete(cmd);
     if(ret != ESP_OK) {
         ESP_LOGE(TAG, "SCCB_Write Failed addr:0x%02x, reg:0x%02x, data:0x%02x, ret:%d", slv_addr, reg, data, ret);
+    } else if (write_hook) {
+        write_hook(slv_addr, reg, data);
+    }
+    return ret == ESP_OK ? 0 : -1;
+}
+
+int SCCB_Write_Burst(uint8_t slv_addr, uint8_t reg, const uint8_t *data, size_t len)
+{
+    esp_err_t ret = ESP_FAIL;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, ( slv_addr << 1 ) | WRITE_BIT, ACK_CHECK_EN);
+    i2c_master_write_byte(cmd, reg, ACK_CHECK_EN);
+    i2c_master_write(cmd, data, len, ACK_CHECK_EN);
+    i2c_master_stop(cmd);
+    ret = i2c_master_cmd_begin(sccb_i2c_port, cmd, 1000 / portTICK_RATE_MS);
+    i2c_cmd_link_delete(cmd);
+    if(ret != ESP_OK) {
+        ESP_LOGE(TAG, "SCCB_Write_Burst Failed addr:0x%02x, reg:0x%02x, len:%u, ret:%d", slv_addr, reg, (unsigned)len, ret);
     }
     return ret == ESP_OK ? 0 : -1;
 }
 
+void SCCB_Set_Write_Hook(sccb_write_hook_t hook)
+{
+    write_hook = hook;
+}
+
 uint8_t SCCB_Read16(uint8_t slv_addr, uint16_t reg)
 {
     uint8_t data=0;
@@ -141,6 +141,17 @@ typedef struct {
     uint32_t fb_size;
 
     cam_state_t state;
+
+    //for streaming (frame_cnt == 0)
+    camera_stream_cb_t stream_cb;
+    void *stream_arg;
+    size_t stream_end;          // bytes of the frame the caller needs
+    size_t stream_len;          // bytes delivered so far
+    esp_err_t stream_err;
+    volatile bool stream_armed; // a caller is waiting for a frame
+    uint8_t *stream_buf;
+    SemaphoreHandle_t stream_lock;
+    SemaphoreHandle_t stream_done;
 } cam_obj_t;
 
 
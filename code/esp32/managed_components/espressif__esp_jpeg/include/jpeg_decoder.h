@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -101,6 +104,61 @@ esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *im
  */
 esp_err_t esp_jpeg_get_image_info(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img);
 
+/**
+ * @brief Maximum number of regions for esp_jpeg_decode_rois()
+ */
+#define ESP_JPEG_MAX_ROIS   16
+
+/**
+ * @brief Rectangle in the input image, edges inclusive
+ */
+typedef struct {
+    uint16_t left;
+    uint16_t right;
+    uint16_t top;
+    uint16_t bottom;
+} esp_jpeg_rect_t;
+
+/**
+ * @brief Called with each decoded MCU that overlaps one of the regions
+ *
+ * @param[in] arg:    User argument passed to esp_jpeg_decode_rois()
+ * @param[in] pixels: RGB888 pixels of the MCU, row-major, rect width x height
+ * @param[in] rect:   Position of the MCU in the output image (scaled by out_scale)
+ *
+ * @return true to continue, false to stop decoding
+ */
+typedef bool (*esp_jpeg_block_cb_t)(void *arg, const uint8_t *pixels, const esp_jpeg_rect_t *rect);
+
+/**
+ * @brief Decode only the parts of a JPEG image covering the given regions
+ *
+ * MCUs that don't overlap a region are entropy decoded to stay in sync but
+ * skip dequantization, IDCT and color conversion. Restart intervals with no
+ * region in them are skipped without decoding, and decoding stops after the
+ * last MCU row containing a region. No output buffer is needed;
+ * cfg->outbuf, outbuf_size, out_format and flags are not used.
+ *
+ * @note Not available with the ROM decoder (CONFIG_JD_USE_ROM) or with
+ *       RGB565-only output (CONFIG_JD_FORMAT_RGB565).
+ *
+ * @param[in]  cfg:       Configuration structure (indata, out_scale, advanced)
+ * @param[in]  rois:      Regions in input image pixels
+ * @param[in]  roi_count: Number of regions, up to ESP_JPEG_MAX_ROIS
+ * @param[in]  cb:        Called for each decoded MCU
+ * @param[in]  arg:       Passed to cb
+ * @param[out] img:       Output image info, as esp_jpeg_get_image_info(); may be NULL
+ *
+ * @return
+ *      - ESP_OK                on success, or if cb stopped the decoding
+ *      - ESP_ERR_INVALID_ARG   if an argument is NULL
+ *      - ESP_ERR_NO_MEM        if there is no memory for the working buffer
+ *      - ESP_ERR_NOT_SUPPORTED with the ROM decoder or RGB565-only output
+ *      - ESP_FAIL              if there is an error in decoding JPEG
+ */
+esp_err_t esp_jpeg_decode_rois(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_rect_t *rois, size_t roi_count,
+                               esp_jpeg_block_cb_t cb, void *arg, esp_jpeg_image_output_t *img);
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,9 @@ static uint8_t jpeg_get_color_bytes(esp_jpeg_image_format_t format);
 
 static unsigned int jpeg_decode_in_cb(JDEC *jd, uint8_t *buff, unsigned int nbyte);
 static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *jd, void *bitmap, JRECT *rect);
+#if !CONFIG_JD_USE_ROM
+static int jpeg_decode_roi_out_cb(JDEC *jd, void *bitmap, JRECT *rect);
+#endif
 static inline uint16_t ldb_word(const void *ptr);
 /*******************************************************************************
 * Public API functions
@@ -121,6 +124,78 @@ err:
     return ret;
 }
 
+#if !CONFIG_JD_USE_ROM
+/* Session state for esp_jpeg_decode_rois(). cfg comes first so the input
+ * callback can treat the device pointer as the configuration. */
+typedef struct {
+    esp_jpeg_image_cfg_t cfg;
+    esp_jpeg_block_cb_t cb;
+    void *arg;
+} jpeg_roi_session_t;
+#endif
+
+esp_err_t esp_jpeg_decode_rois(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_rect_t *rois, size_t roi_count,
+                               esp_jpeg_block_cb_t cb, void *arg, esp_jpeg_image_output_t *img)
+{
+#if CONFIG_JD_USE_ROM || JD_FORMAT != 0
+    (void)cfg; (void)rois; (void)roi_count; (void)cb; (void)arg; (void)img;
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    esp_err_t ret = ESP_OK;
+    uint8_t *workbuf = NULL;
+    JRESULT res;
+    JDEC JDEC;
+    JRECT rects[ESP_JPEG_MAX_ROIS];
+
+    ESP_RETURN_ON_FALSE(cfg && cb && (rois || roi_count == 0), ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(roi_count <= sizeof(rects) / sizeof(rects[0]), ESP_ERR_INVALID_ARG, TAG, "Too many regions");
+
+    const bool allocate_buffer = (cfg->advanced.working_buffer == NULL);
+    const size_t workbuf_size = allocate_buffer ? JPEG_WORK_BUF_SIZE : cfg->advanced.working_buffer_size;
+    if (allocate_buffer) {
+        workbuf = heap_caps_malloc(JPEG_WORK_BUF_SIZE, MALLOC_CAP_DEFAULT);
+        ESP_RETURN_ON_FALSE(workbuf, ESP_ERR_NO_MEM, TAG, "no mem for JPEG work buffer");
+    } else {
+        workbuf = cfg->advanced.working_buffer;
+        ESP_RETURN_ON_FALSE(workbuf_size != 0, ESP_ERR_INVALID_ARG, TAG, "Working buffer size not defined!");
+    }
+
+    jpeg_roi_session_t session = {
+        .cfg = *cfg,
+        .cb = cb,
+        .arg = arg,
+    };
+    session.cfg.priv.read = 0;
+
+    for (size_t i = 0; i < roi_count; i++) {
+        rects[i].left = rois[i].left;
+        rects[i].right = rois[i].right;
+        rects[i].top = rois[i].top;
+        rects[i].bottom = rois[i].bottom;
+    }
+
+    res = jd_prepare(&JDEC, jpeg_decode_in_cb, workbuf, workbuf_size, &session);
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in preparing JPEG image! %d", res);
+
+    if (img) {
+        const uint8_t scale_div = jpeg_get_div_by_scale(cfg->out_scale);
+        img->height = JDEC.height / scale_div;
+        img->width = JDEC.width / scale_div;
+        img->output_len = 0;
+    }
+
+    res = jd_decomp_rect(&JDEC, jpeg_decode_roi_out_cb, cfg->out_scale, rects, roi_count);
+    ESP_GOTO_ON_FALSE((res == JDR_OK || res == JDR_INTR), ESP_FAIL, err, TAG, "Error in decoding JPEG image! %d", res);
+
+err:
+    if (workbuf && allocate_buffer) {
+        free(workbuf);
+    }
+
+    return ret;
+#endif
+}
+
 esp_err_t esp_jpeg_get_image_info(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img)
 {
     if (cfg == NULL || img == NULL) {
@@ -246,6 +321,22 @@ static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *dec, void *bitmap, JRECT *rect
     return 1;
 }
 
+#if !CONFIG_JD_USE_ROM
+static int jpeg_decode_roi_out_cb(JDEC *dec, void *bitmap, JRECT *rect)
+{
+    jpeg_roi_session_t *session = (jpeg_roi_session_t *)dec->device;
+    assert(session != NULL);
+
+    const esp_jpeg_rect_t r = {
+        .left = rect->left,
+        .right = rect->right,
+        .top = rect->top,
+        .bottom = rect->bottom,
+    };
+    return session->cb(session->arg, (const uint8_t *)bitmap, &r) ? 1 : 0;
+}
+#endif
+
 static uint8_t jpeg_get_div_by_scale(esp_jpeg_image_scale_t scale)
 {
     switch (scale) {
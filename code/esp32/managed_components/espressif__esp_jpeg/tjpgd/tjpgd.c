@@ -22,6 +22,7 @@
 / Jun 11, 2021 R0.02a Some performance improvement.
 / Jul 01, 2021 R0.03  Added JD_FASTDECODE option.
 /                     Some performance improvement.
+/ (local)             Added jd_decomp_rect() for decoding regions only.
 /----------------------------------------------------------------------------*/
 
 #include "tjpgd.h"
@@ -694,6 +695,56 @@ static JRESULT restart (
 
 
 
+#if JD_FASTDECODE >= 1
+/*-----------------------------------------------------------------------*/
+/* Skip the rest of a restart interval without decoding it               */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT skip_interval (
+    JDEC *jd        /* Pointer to the decompressor object */
+)
+{
+    size_t dc = jd->dctr;
+    uint8_t *dp = jd->dptr;
+    unsigned int d, flg = 0;
+
+
+    if (jd->marker) {   /* The bit reader has already stopped at the marker */
+        jd->dbit = 0;
+        return JDR_OK;
+    }
+
+    for (;;) {  /* Scan for the next RSTn marker; entropy coded data never contains one */
+        if (!dc) {  /* Buffer empty, re-fill input buffer */
+            dp = jd->inbuf;
+            dc = jd->infunc(jd, dp, JD_SZBUF);
+            if (!dc) {
+                return JDR_INP;    /* Err: wrong stream termination */
+            }
+        }
+        d = *dp++; dc--;
+        if (flg) {
+            if (d >= 0xD0 && d <= 0xD7) {
+                break;  /* RSTn */
+            }
+            if (d != 0 && d != 0xFF) {
+                return JDR_FMT1;    /* Err: another marker before the next restart (may be collapted data) */
+            }
+            flg = (d == 0xFF);  /* 0xFF 0x00 is data, 0xFF 0xFF is fill */
+        } else {
+            flg = (d == 0xFF);
+        }
+    }
+    jd->dptr = dp; jd->dctr = dc;
+    jd->marker = (uint8_t)d;    /* Let restart() pick it up */
+    jd->dbit = 0;               /* Discard buffered bits of the skipped data */
+
+    return JDR_OK;
+}
+#endif
+
+
+
 
 /*-----------------------------------------------------------------------*/
 /* Apply Inverse-DCT in Arai Algorithm (see also aa_idct.png)            */
@@ -823,7 +874,8 @@ static void block_idct (
 /*-----------------------------------------------------------------------*/
 
 static JRESULT mcu_load (
-    JDEC *jd        /* Pointer to the decompressor object */
+    JDEC *jd,       /* Pointer to the decompressor object */
+    int out         /* 0: only keep the stream in sync, the MCU is not output */
 )
 {
     int32_t *tmp = (int32_t *)jd->workbuf;  /* Block working buffer for de-quantize and IDCT */
@@ -868,7 +920,9 @@ static JRESULT mcu_load (
             tmp[0] = d * dqf[0] >> 8;               /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
 
             /* Extract following 63 AC elements from input stream */
-            memset(&tmp[1], 0, 63 * sizeof (int32_t));  /* Initialize all AC elements */
+            if (out) {
+                memset(&tmp[1], 0, 63 * sizeof (int32_t));  /* Initialize all AC elements */
+            }
             z = 1;      /* Top of the AC elements (in zigzag-order) */
             do {
                 d = huffext(jd, id, 1);             /* Extract a huffman coded value (zero runs and bit length) */
@@ -892,12 +946,14 @@ static JRESULT mcu_load (
                     if (!(d & bc)) {
                         d -= (bc << 1) - 1;    /* Restore negative value if needed */
                     }
-                    i = Zig[z];                     /* Get raster-order index */
-                    tmp[i] = d * dqf[i] >> 8;       /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+                    if (out) {
+                        i = Zig[z];                 /* Get raster-order index */
+                        tmp[i] = d * dqf[i] >> 8;   /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+                    }
                 }
             } while (++z < 64);     /* Next AC element */
 
-            if (JD_FORMAT != 2 || !cmp) {   /* C components may not be processed if in grayscale output */
+            if (out && (JD_FORMAT != 2 || !cmp)) {  /* C components may not be processed if in grayscale output */
                 if (z == 1 || (JD_USE_SCALE && jd->scale == 3)) {   /* If no AC element or scale ratio is 1/8, IDCT can be ommited and the block is filled with DC value */
                     d = (jd_yuv_t)((*tmp / 256) + 128);
                     if (JD_FASTDECODE >= 1) {
@@ -1377,7 +1433,7 @@ JRESULT jd_decomp (
                 }
                 rst = 1;
             }
-            rc = mcu_load(jd);                  /* Load an MCU (decompress huffman coded stream, dequantize and apply IDCT) */
+            rc = mcu_load(jd, 1);               /* Load an MCU (decompress huffman coded stream, dequantize and apply IDCT) */
             if (rc != JDR_OK) {
                 return rc;
             }
@@ -1390,3 +1446,117 @@ JRESULT jd_decomp (
 
     return rc;
 }
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decompress only the MCUs that overlap the given rectangles            */
+/*-----------------------------------------------------------------------*/
+/* Huffman coding is sequential, so MCUs ahead of a region still have to
+/  be entropy decoded, but they skip dequantization, IDCT and color
+/  conversion. Restart intervals without any region in them are skipped by
+/  scanning for the next RSTn marker, and decoding stops after the MCU row
+/  holding the bottom of the lowest rectangle. */
+
+static int mcu_in_rect (
+    unsigned int x, unsigned int y,     /* MCU location in the image */
+    unsigned int mx, unsigned int my,   /* MCU size */
+    const JRECT *rect,                  /* Rectangles in the input image (inclusive) */
+    unsigned int nrect
+)
+{
+    unsigned int i;
+
+    for (i = 0; i < nrect; i++) {
+        if (rect[i].left <= rect[i].right && rect[i].top <= rect[i].bottom &&
+            x <= rect[i].right && x + mx > rect[i].left && y <= rect[i].bottom && y + my > rect[i].top) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+JRESULT jd_decomp_rect (
+    JDEC *jd,                               /* Initialized decompression object */
+    int (*outfunc)(JDEC *, void *, JRECT *), /* RGB output function */
+    uint8_t scale,                          /* Output de-scaling factor (0 to 3) */
+    const JRECT *rect,                      /* Regions to decode, in input image pixels */
+    unsigned int nrect                      /* Number of regions */
+)
+{
+    unsigned int x, y, mx, my, ncol, n, nend, i, bottom;
+    uint16_t rsc;
+    JRESULT rc;
+
+
+    if (scale > (JD_USE_SCALE ? 3 : 0) || (nrect && !rect)) {
+        return JDR_PAR;
+    }
+    jd->scale = scale;
+
+    mx = jd->msx * 8; my = jd->msy * 8;         /* Size of the MCU (pixel) */
+    ncol = (jd->width + mx - 1) / mx;           /* MCUs per row */
+
+    if (!nrect) {
+        return JDR_OK;
+    }
+    bottom = 0;
+    for (i = 0; i < nrect; i++) {
+        if (rect[i].top <= rect[i].bottom && rect[i].bottom > bottom) {
+            bottom = rect[i].bottom;
+        }
+    }
+    if (bottom >= jd->height) {
+        bottom = jd->height - 1;
+    }
+    nend = (bottom / my + 1) * ncol;            /* MCUs up to the end of the last row needed */
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Initialize DC values */
+    rsc = 0;
+
+    for (n = 0; n < nend; ) {
+        if (jd->nrst && n && n % jd->nrst == 0) {   /* Process restart interval if enabled */
+            rc = restart(jd, rsc++);
+            if (rc != JDR_OK) {
+                return rc;
+            }
+        }
+#if JD_FASTDECODE >= 1
+        if (jd->nrst && n % jd->nrst == 0) {    /* Is anything needed in this interval? */
+            for (i = n; i < n + jd->nrst && i < nend; i++) {
+                if (mcu_in_rect((i % ncol) * mx, (i / ncol) * my, mx, my, rect, nrect)) {
+                    break;
+                }
+            }
+            if (i >= nend) {
+                break;      /* Nothing more to output */
+            }
+            if (i >= n + jd->nrst) {
+                rc = skip_interval(jd);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                n += jd->nrst;
+                continue;
+            }
+        }
+#endif
+        x = (n % ncol) * mx; y = (n / ncol) * my;
+        i = mcu_in_rect(x, y, mx, my, rect, nrect);
+        rc = mcu_load(jd, i);                   /* Load an MCU (always decompress huffman coded stream) */
+        if (rc != JDR_OK) {
+            return rc;
+        }
+        if (i) {
+            rc = mcu_output(jd, outfunc, x, y); /* Output the MCU (YCbCr to RGB, scaling and output) */
+            if (rc != JDR_OK) {
+                return rc;
+            }
+        }
+        n++;
+    }
+
+    return JDR_OK;
+}
@@ -2,8 +2,6 @@
 # Uses Peak Sun Hours (e.g., 4.9 h) instead of a 12 h daylight bell
 
 import math
-import numpy as np
-import matplotlib.pyplot as plt
 
 # ---------------------- PARAMETERS (EDIT) ----------------------
 days_to_sim         = 30            # total days
@@ -73,37 +71,48 @@ def pv_power_W(hour_idx):
     # During PSH window, deliver (approximately) Wp * derates
     return panel_Wp * pv_derate_total
 
-# Simulate
-hours = np.arange(n_steps)
-soc = []
-brown = []
-for t in hours:
-    P_pv = pv_power_W(t)
-    E_pv = max(0.0, P_pv * dt_h) * eta_chg
-    E_ld = E_load_per_h / eta_dis
-
-    E = min(E_max, max(E_min, E + E_pv - E_ld))
-    soc.append(100.0 * (E / E_max if E_max > 0 else 0.0))
-    brown.append(1 if (E <= E_min + 1e-9 and (E_pv - E_ld) < 0) else 0)
-
-# Report
-print("=== SIM SUMMARY ===")
-print(f"Usable battery: {E_max:.2f} Wh  (from {battery_mAh} mAh @ {battery_V} V, DoD={usable_DoD:.2f})")
-print(f"Panel: {panel_Wp} W  | PSH: {psh_hours} h/day  | Derate total: {pv_derate_total:.3f} (temp@{ambient_C}°C={temp_der:.3f})")
-print(f"Avg load: {avg_load_W:.3f} W (incl. pump & LoRa bursts)")
-print(f"Min SoC over {days_to_sim} d: {min(soc):.2f}%")
-if any(brown):
-    first = np.where(np.array(brown) == 1)[0][0]
-    print(f"Brownout at hour ~{first}")
-else:
-    print("No brownouts.")
-
-# Plot SoC
-plt.figure(figsize=(10,5))
-plt.plot(hours, soc)
-plt.xlabel("Hours since start")
-plt.ylabel("State of Charge (%)")
-plt.title("Battery SoC vs Time — PSH Model (hourly)")
-plt.grid(True)
-plt.tight_layout()
-plt.show()
+def main():
+    # numpy/matplotlib are only needed here, so policy_replay.py can import
+    # the parameters and PV model without them
+    import numpy as np
+    import matplotlib.pyplot as plt
+    global E
+
+    # Simulate
+    hours = np.arange(n_steps)
+    soc = []
+    brown = []
+    for t in hours:
+        P_pv = pv_power_W(t)
+        E_pv = max(0.0, P_pv * dt_h) * eta_chg
+        E_ld = E_load_per_h / eta_dis
+
+        E = min(E_max, max(E_min, E + E_pv - E_ld))
+        soc.append(100.0 * (E / E_max if E_max > 0 else 0.0))
+        brown.append(1 if (E <= E_min + 1e-9 and (E_pv - E_ld) < 0) else 0)
+
+    # Report
+    print("=== SIM SUMMARY ===")
+    print(f"Usable battery: {E_max:.2f} Wh  (from {battery_mAh} mAh @ {battery_V} V, DoD={usable_DoD:.2f})")
+    print(f"Panel: {panel_Wp} W  | PSH: {psh_hours} h/day  | Derate total: {pv_derate_total:.3f} (temp@{ambient_C}°C={temp_der:.3f})")
+    print(f"Avg load: {avg_load_W:.3f} W (incl. pump & LoRa bursts)")
+    print(f"Min SoC over {days_to_sim} d: {min(soc):.2f}%")
+    if any(brown):
+        first = np.where(np.array(brown) == 1)[0][0]
+        print(f"Brownout at hour ~{first}")
+    else:
+        print("No brownouts.")
+
+    # Plot SoC
+    plt.figure(figsize=(10,5))
+    plt.plot(hours, soc)
+    plt.xlabel("Hours since start")
+    plt.ylabel("State of Charge (%)")
+    plt.title("Battery SoC vs Time — PSH Model (hourly)")
+    plt.grid(True)
+    plt.tight_layout()
+    plt.show()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,144 @@
+# ---- Replay battery_calculator.py scenarios against the sensor power policy ----
+# Builds code/esp32/main/sensor/power_policy.c for the host, then runs the
+# calculator's hourly PSH battery model with the ESP's load derived from the
+# plan the firmware would pick each hour. Exits non-zero if the policy does
+# worse than the fixed schedule in any scenario.
+
+import ctypes
+import os
+import subprocess
+import sys
+import tempfile
+
+import battery_calculator as calc
+
+REPO = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+SENSOR_DIR = os.path.join(REPO, 'code', 'esp32', 'main', 'sensor')
+
+# ---------------------- FIRMWARE LOADS (EDIT) ----------------------
+# These replace the calculator's load_base_W; pump and LoRa bursts are kept.
+sleep_W         = 0.002   # deep sleep + battery divider
+wake_J          = 0.6     # one depth wake: Wi-Fi/ESP-NOW up, measure, log
+depth_period_s  = 10      # CH_DEPTH period at stretch 1
+probe_J         = 0.1     # extra for an EC/thermistor sample
+probe_period_s  = 30 * 60
+camera_J        = 2.4     # init + capture
+camera_hour     = 12      # CH_COLOR slot, solar noon
+upload_J        = 18.0    # full log upload to the boat
+boat_hour       = 16      # boat passes once a day
+# -------------------------------------------------------------------
+
+CH_DEPTH, CH_PROBE, CH_COLOR = 1 << 0, 1 << 1, 1 << 2
+LEVELS = ['NORMAL', 'SAVE', 'LOW', 'CRITICAL']
+
+SCENARIOS = [
+    # name, overrides of battery_calculator parameters
+    ('calculator defaults', {}),
+    ('overcast (PSH 0.8)', {'psh_hours': 0.8}),
+    ('small battery, poor sun', {'battery_mAh': 1000, 'psh_hours': 1.0}),
+    ('no sun', {'psh_hours': 0.0, 'days_to_sim': 10}),
+]
+
+
+class PowerPlan(ctypes.Structure):
+    _fields_ = [('level', ctypes.c_int),
+                ('stretch', ctypes.c_uint8),
+                ('channels', ctypes.c_uint32),
+                ('upload', ctypes.c_bool)]
+
+
+def build_policy():
+    out = os.path.join(tempfile.mkdtemp(), 'power_policy.so')
+    subprocess.check_call(['cc', '-shared', '-fPIC', '-O2', '-I', SENSOR_DIR,
+                           os.path.join(SENSOR_DIR, 'power_policy.c'), '-o', out])
+    lib = ctypes.CDLL(out)
+    lib.power_plan.restype = PowerPlan
+    lib.power_plan.argtypes = [ctypes.c_uint8, ctypes.c_int, ctypes.c_int]
+    return lib
+
+
+def simulate(lib, params, use_policy):
+    saved = {k: getattr(calc, k) for k in params}
+    for k, v in params.items():
+        setattr(calc, k, v)
+    try:
+        E_max = (calc.battery_mAh / 1000.0) * calc.battery_V * calc.usable_DoD
+        E = E_max * calc.soc_start
+        n_steps = int(calc.days_to_sim * 24 / calc.dt_h)
+        other_Wh = (calc.pump_W * calc.pump_s_per_hour + calc.lora_W * calc.lora_s_per_hour) / 3600.0
+
+        level = 0
+        camera_pending = upload_pending = False
+        soc_min, brownout = 100.0, None
+        hours_at = [0] * len(LEVELS)
+
+        for t in range(n_steps):
+            hour = t % 24  # solar hour, like the calculator's PV curve and power_plan()
+            soc = 100.0 * E / E_max if E_max > 0 else 0.0
+            if use_policy:
+                plan = lib.power_plan(int(soc), hour, level)
+            else:
+                plan = lib.power_plan(100, hour, 0)
+            level = plan.level
+            hours_at[level] += 1
+
+            if hour == camera_hour:
+                camera_pending = True
+            if hour == boat_hour:
+                upload_pending = True
+
+            J = sleep_W * 3600.0 * calc.dt_h
+            J += wake_J * 3600.0 / (depth_period_s * plan.stretch)
+            if plan.channels & CH_PROBE:
+                J += probe_J * 3600.0 / (probe_period_s * plan.stretch)
+            if camera_pending and plan.channels & CH_COLOR:
+                J += camera_J
+                camera_pending = False
+            # The boat only answers while it's nearby
+            if upload_pending and hour == boat_hour and plan.upload:
+                J += upload_J
+                upload_pending = False
+
+            E_pv = max(0.0, calc.pv_power_W(t) * calc.dt_h) * calc.eta_chg
+            E_ld = (J / 3600.0 + other_Wh) / calc.eta_dis
+            E = min(E_max, max(0.0, E + E_pv - E_ld))
+
+            soc = 100.0 * E / E_max if E_max > 0 else 0.0
+            soc_min = min(soc_min, soc)
+            if brownout is None and E <= 1e-9 and E_pv - E_ld < 0:
+                brownout = t
+
+        return soc_min, brownout, hours_at, n_steps
+    finally:
+        for k, v in saved.items():
+            setattr(calc, k, v)
+
+
+def main():
+    lib = build_policy()
+    failed = False
+
+    for name, params in SCENARIOS:
+        f_min, f_brown, _, n = simulate(lib, params, use_policy=False)
+        p_min, p_brown, at, _ = simulate(lib, params, use_policy=True)
+
+        print(f"=== {name} ===")
+        print(f"fixed : min SoC {f_min:6.2f}%  brownout {'hour ~%d' % f_brown if f_brown is not None else 'none'}")
+        print(f"policy: min SoC {p_min:6.2f}%  brownout {'hour ~%d' % p_brown if p_brown is not None else 'none'}")
+        print("        hours at " + ", ".join(f"{LEVELS[i]} {at[i]}" for i in range(len(LEVELS))))
+
+        if p_min + 1e-6 < f_min:
+            print("FAIL: policy ends with less charge than the fixed schedule")
+            failed = True
+        if p_brown is not None and (f_brown is None or p_brown < f_brown):
+            print("FAIL: policy browns out earlier than the fixed schedule")
+            failed = True
+        if not params and at[0] < 0.95 * n:
+            print("FAIL: policy degrades sampling with the calculator's default sun")
+            failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,109 @@
+# ---- Check the sensor's ROI stats kernel against its per-pixel reference ----
+# Builds code/esp32/main/sensor/roi_stats.h for the host and compares
+# roi_stats() with roi_stats_ref() on random frames: padded strides, odd
+# sizes, rectangles clipped at every edge or off the frame, odd x offsets,
+# all four byte/R-B order flags, histograms on. Exits non-zero on any
+# difference. Needs a C compiler; run it from docs/tools:
+#   python3 roi_stats_check.py
+
+import ctypes
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+SENSOR_DIR = os.path.join(REPO, 'code', 'esp32', 'main', 'sensor')
+
+FRAMES = 40
+RECTS_PER_FRAME = 50
+SEED = 1
+
+FLAGS = [('RGB565 LE', 0), ('BGR565 LE', 1), ('RGB565 BE', 2), ('BGR565 BE', 3)]
+
+# Both versions on the same rectangle; 0 = identical results
+SHIM = r'''
+#include "roi_stats.h"
+
+static int same(const roi_stats_t *a, const roi_stats_t *b)
+{
+    if (a->count != b->count) return 0;
+    for (int c = 0; c < 3; c++) {
+        if (a->sum[c] != b->sum[c] || a->sumsq[c] != b->sumsq[c]) return 0;
+        for (int k = 0; k < ROI_STATS_BINS; k++) {
+            if (a->hist[c][k] != b->hist[c][k]) return 0;
+        }
+    }
+    return 1;
+}
+
+int check(const uint8_t *buf, int width, int height, size_t stride,
+          int x, int y, int w, int h, uint32_t flags)
+{
+    roi_rect_t r = {x, y, w, h};
+    roi_stats_t fast, ref;
+    memset(&fast, 0xA5, sizeof(fast));
+    const bool ok_fast = roi_stats(buf, width, height, stride, r, flags, true, &fast);
+    const bool ok_ref = roi_stats_ref(buf, width, height, stride, r, flags, true, &ref);
+    if (ok_fast != ok_ref) return 1;
+    return same(&fast, &ref) ? 0 : 2;
+}
+'''
+
+
+def build_kernel():
+    tmp = tempfile.mkdtemp()
+    src = os.path.join(tmp, 'roi_stats_shim.c')
+    out = os.path.join(tmp, 'roi_stats.so')
+    with open(src, 'w') as f:
+        f.write(SHIM)
+    subprocess.check_call(['cc', '-shared', '-fPIC', '-O2', '-std=c11', '-I', SENSOR_DIR, src, '-o', out])
+    lib = ctypes.CDLL(out)
+    lib.check.restype = ctypes.c_int
+    lib.check.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_size_t,
+                          ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_uint32]
+    return lib
+
+
+def random_rect(rng, width, height):
+    kind = rng.randrange(4)
+    if kind == 0:    # inside, odd x offsets as likely as even
+        x, y = rng.randrange(width), rng.randrange(height)
+        return x, y, rng.randint(1, width - x), rng.randint(1, height - y)
+    if kind == 1:    # hanging over one or more edges
+        w, h = rng.randint(1, width + 8), rng.randint(1, height + 8)
+        return rng.randint(-w + 1, width - 1), rng.randint(-h + 1, height - 1), w, h
+    if kind == 2:    # bigger than the frame
+        return rng.randint(-9, 0), rng.randint(-9, 0), width + 20, height + 20
+    # nothing left after clipping, or empty
+    return rng.choice([(width, 0, 4, 4), (-5, 0, 5, 3), (0, height + 1, 3, 3), (2, 2, 0, 5)])
+
+
+def main():
+    rng = random.Random(SEED)
+    lib = build_kernel()
+    failures = checked = 0
+
+    for _ in range(FRAMES):
+        width, height = rng.randint(1, 97), rng.randint(1, 61)
+        stride = width * 2 + rng.choice([0, 0, 2, 6, 64])
+        frame = bytes(rng.getrandbits(8) for _ in range(stride * height))
+        for _ in range(RECTS_PER_FRAME):
+            x, y, w, h = random_rect(rng, width, height)
+            for name, flags in FLAGS:
+                checked += 1
+                res = lib.check(frame, width, height, stride, x, y, w, h, flags)
+                if res:
+                    failures += 1
+                    if failures <= 10:
+                        what = 'return value' if res == 1 else 'stats'
+                        print(f'MISMATCH ({what}) {name}: frame {width}x{height} stride {stride}, '
+                              f'rect x={x} y={y} w={w} h={h}')
+
+    print(f'{checked} rectangles checked, {failures} mismatches')
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())